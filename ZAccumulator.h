@@ -0,0 +1,280 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZAccumulator_DEFINED
+#define ZAccumulator_DEFINED
+
+#include "GMatrix.h"
+#include "GPath.h"
+#include "GPoint.h"
+#include "ZBezier.h"
+#include "ZBlitter.h"
+#include "ZPath.h"
+#include "ZSimd.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/**
+ *  Signed area rasterizer (the font-rs approach). Every line adds, to each pixel it passes
+ *  through, the change in coverage it causes for that pixel and the pixels to its right. A
+ *  running sum along the row then gives each pixel's coverage, so there is no edge sorting
+ *  and no per-scanline edge list: a path costs O(edge length + area touched).
+ *
+ *  Coverage is |sum| clamped to 1, which is the non-zero winding rule for whole pixels.
+ *
+ *  The buffer only covers a window of the device (the path's bounds, within the clip), and
+ *  the path is accumulated relative to the window's top left. The buffer grows to the largest
+ *  window it has held, so small paths on a large device stay small.
+ */
+class ZAccumulator {
+
+public:
+
+    ZAccumulator() : fOriginX(0), fOriginY(0), fWidth(0), fHeight(0), fStride(0), fTop(0), fBottom(0), fLeft(0), fRight(0) {}
+
+    //The buffer is kept (and left zeroed by blit) between paths, so it is only ever grown
+    void reset(const GIRect& window) {
+        fOriginX = window.fLeft;
+        fOriginY = window.fTop;
+        fWidth = window.width();
+        fHeight = window.height();
+        //Lines on the right side write up to two past the last pixel
+        fStride = fWidth + 2;
+        size_t size = (size_t)fStride * fHeight;
+        if (fArea.size() < size) fArea.resize(size, 0.0f);
+        if ((int)fAlpha.size() < fWidth + 1) {
+            fAlpha.resize(fWidth + 1);
+            fRuns.resize(fWidth + 1);
+        }
+        fTop = fHeight;
+        fBottom = 0;
+        fLeft = fWidth;
+        fRight = 0;
+    }
+
+    //Add a path, mapping each segment into the window as it is reached
+    void addPath(const GPath& path, const GMatrix& matrix) {
+        const float top = fOriginY;
+        const float bottom = fOriginY + fHeight;
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Edger edger(path);
+        GPath::Verb v;
+        while ((v = edger.next(pts)) != GPath::kDone) {
+            switch (v) {
+                case GPath::kLine:
+                    if (!mapSegment(matrix, pts, 2, top, bottom)) break;
+                    toWindow(pts, 2);
+                    addLine(pts[0], pts[1]);
+                    break;
+                case GPath::kQuad:
+                    if (!mapSegment(matrix, pts, kQuadNumber, top, bottom)) break;
+                    toWindow(pts, kQuadNumber);
+                    addCurve(pts, &quadBezier, std::max(numberOfQuadSegments(pts), 1), pts[2]);
+                    break;
+                case GPath::kCubic:
+                    if (!mapSegment(matrix, pts, kCubicNumber, top, bottom)) break;
+                    toWindow(pts, kCubicNumber);
+                    addCurve(pts, &cubicBezier, std::max(numberOfCubicSegments(pts), 1), pts[3]);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    //Move mapped points into the window, after mapping so they round as they would on the device
+    void toWindow(GPoint pts[], int count) const {
+        for (int i = 0; i < count; i++) {
+            pts[i] = GPoint::Make(pts[i].x() - fOriginX, pts[i].y() - fOriginY);
+        }
+    }
+
+    //Clip the line to the window and accumulate it
+    void addLine(GPoint p0, GPoint p1) {
+        if (p0.y() == p1.y()) return;
+        float dir = 1;
+        if (p0.y() > p1.y()) {
+            std::swap(p0, p1);
+            dir = -1;
+        }
+        //Rows above and below the window never reach the prefix sum
+        if (p1.y() <= 0 || p0.y() >= fHeight) return;
+        float dxdy = (p1.x() - p0.x()) / (p1.y() - p0.y());
+        if (p0.y() < 0) p0 = GPoint::Make(p0.x() - p0.y() * dxdy, 0);
+        if (p1.y() > fHeight) p1 = GPoint::Make(p1.x() + (fHeight - p1.y()) * dxdy, fHeight);
+
+        //Split where the line leaves the sides. Outside pieces collapse onto the side, which
+        //keeps their winding for the pixels inside.
+        float ys[4] = { p0.y(), p0.y(), p0.y(), p1.y() };
+        int count = 1;
+        if (dxdy != 0) {
+            for (float side : { 0.0f, (float)fWidth }) {
+                float y = p0.y() + (side - p0.x()) / dxdy;
+                if (y > p0.y() && y < p1.y()) ys[count++] = y;
+            }
+            if (count == 3 && ys[1] > ys[2]) std::swap(ys[1], ys[2]);
+        }
+        ys[count] = p1.y();
+        for (int i = 0; i < count; i++) {
+            GPoint a = GPoint::Make(clampX(p0.x() + (ys[i] - p0.y()) * dxdy), ys[i]);
+            GPoint b = GPoint::Make(clampX(p0.x() + (ys[i + 1] - p0.y()) * dxdy), ys[i + 1]);
+            if (i == count - 1) b = GPoint::Make(clampX(p1.x()), p1.y());
+            accumulateLine(a, b, dir);
+        }
+    }
+
+    /**
+     *  Resolve the touched rows into coverage and hand them to the blitter as runs, zeroing the
+     *  buffer on the way. Aliased paints keep only pixels that are at least half covered.
+     *
+     *  Only the columns the path touched are resolved. Left of them the sum is 0, and right of
+     *  them it is the path's total winding, which is 0 for closed contours.
+     */
+    void blit(ZBlitter* blitter, bool antiAlias) {
+        int width = std::min(fRight, fWidth) - fLeft;
+        uint8_t* alpha = fAlpha.data() + fLeft;
+        int16_t* runs = fRuns.data() + fLeft;
+        for (int y = fTop; y < fBottom && width > 0; y++) {
+            float* row = &fArea[(size_t)y * fStride + fLeft];
+            resolveRow(row, alpha, width, antiAlias);
+            if (buildRuns(alpha, runs, width)) blitter->blitAntiH(fOriginX + fLeft, fOriginY + y, alpha, runs);
+        }
+        //Columns past the window only hold writes from lines on the right side
+        for (int y = fTop; y < fBottom && fRight > fWidth; y++) {
+            float* row = &fArea[(size_t)y * fStride];
+            std::fill(row + fWidth, row + fRight, 0.0f);
+        }
+        fTop = fHeight;
+        fBottom = 0;
+        fLeft = fWidth;
+        fRight = 0;
+    }
+
+private:
+
+    float clampX(float x) const {
+        return std::max(0.0f, std::min((float)fWidth, x));
+    }
+
+    void addCurve(GPoint pts[], BezierFunction bezierFunction, int segments, GPoint last) {
+        GPoint prev = pts[0];
+        float dt = 1.0f / segments;
+        for (int i = 1; i < segments; i++) {
+            GPoint next = bezierFunction(pts, i * dt);
+            addLine(prev, next);
+            prev = next;
+        }
+        addLine(prev, last);
+    }
+
+    //p0 is above p1 and both are inside [0, width] x [0, height]
+    void accumulateLine(GPoint p0, GPoint p1, float dir) {
+        if (p0.y() == p1.y()) return;
+        float dxdy = (p1.x() - p0.x()) / (p1.y() - p0.y());
+        float x = p0.x();
+        int top = (int)p0.y();
+        int bottom = std::min(fHeight, (int)std::ceil(p1.y()));
+        fTop = std::min(fTop, top);
+        fBottom = std::max(fBottom, bottom);
+        fLeft = std::min(fLeft, (int)std::min(p0.x(), p1.x()));
+        fRight = std::min(fStride, std::max(fRight, (int)std::max(p0.x(), p1.x()) + 2));
+        for (int y = top; y < bottom; y++) {
+            float* row = &fArea[(size_t)y * fStride];
+            float dy = std::min((float)(y + 1), p1.y()) - std::max((float)y, p0.y());
+            float xnext = clampX(x + dxdy * dy);
+            float d = dy * dir;
+            float x0 = std::min(x, xnext);
+            float x1 = std::max(x, xnext);
+            float x0floor = std::floor(x0);
+            int x0i = (int)x0floor;
+            float x1ceil = std::ceil(x1);
+            int x1i = (int)x1ceil;
+            if (x1i <= x0i + 1) {
+                //Within one pixel: split by where the line crosses it on average
+                float xmf = 0.5f * (x + xnext) - x0floor;
+                row[x0i] += d - d * xmf;
+                row[x0i + 1] += d * xmf;
+            }
+            else {
+                float s = 1.0f / (x1 - x0);
+                float x0f = x0 - x0floor;
+                float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+                float x1f = x1 - x1ceil + 1.0f;
+                float am = 0.5f * s * x1f * x1f;
+                row[x0i] += d * a0;
+                if (x1i == x0i + 2) {
+                    row[x0i + 1] += d * (1.0f - a0 - am);
+                }
+                else {
+                    float a1 = s * (1.5f - x0f);
+                    row[x0i + 1] += d * (a1 - a0);
+                    for (int xi = x0i + 2; xi < x1i - 1; xi++) {
+                        row[xi] += d * s;
+                    }
+                    float a2 = a1 + (x1i - x0i - 3) * s;
+                    row[x1i - 1] += d * (1.0f - a2 - am);
+                }
+                row[x1i] += d * am;
+            }
+            x = xnext;
+        }
+    }
+
+    //Prefix sum the row into 8 bit coverage and clear it for the next path
+    static void resolveRow(float* row, uint8_t* alpha, int width, bool antiAlias) {
+        float sum = 0;
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 zero = _mm_setzero_ps();
+        __m128 carry = zero;
+        for (; x + 4 <= width; x += 4) {
+            //Inclusive scan of 4 lanes in two shifted adds, plus the total so far
+            __m128 v = _mm_loadu_ps(row + x);
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+            v = _mm_add_ps(v, carry);
+            carry = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm_storeu_ps(row + x, zero);
+
+            __m128 c = _mm_min_ps(_mm_andnot_ps(signBit, v), one);
+            if (!antiAlias) c = _mm_and_ps(_mm_cmpge_ps(c, half), one);
+            __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half));
+            i = _mm_packs_epi32(i, i);
+            i = _mm_packus_epi16(i, i);
+            int packed = _mm_cvtsi128_si32(i);
+            std::memcpy(alpha + x, &packed, 4);
+        }
+        sum = _mm_cvtss_f32(carry);
+#endif
+        for (; x < width; x++) {
+            sum += row[x];
+            row[x] = 0;
+            float c = std::min(std::abs(sum), 1.0f);
+            if (!antiAlias) c = c >= 0.5f ? 1.0f : 0.0f;
+            alpha[x] = (uint8_t)(c * 255.0f + 0.5f);
+        }
+    }
+
+    std::vector<float> fArea;
+    std::vector<uint8_t> fAlpha;
+    std::vector<int16_t> fRuns;
+    int fOriginX;
+    int fOriginY;
+    int fWidth;
+    int fHeight;
+    int fStride;
+    int fTop;
+    int fBottom;
+    int fLeft;
+    int fRight;
+
+};
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZArena_DEFINED
+#define ZArena_DEFINED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ *  A bump allocator for the objects a draw needs only while it runs (blitters and their
+ *  buffers). Memory is handed out in order and given back a Scope at a time, and the blocks
+ *  are kept, so once the arena has grown to fit the largest draw it never allocates again.
+ */
+class ZArena {
+
+public:
+
+    ZArena(size_t firstBlock = 4096) : fFirstBlock(firstBlock), fBlock(0), fUsed(0) {}
+
+    ~ZArena() {
+        rewind(0, 0, 0);
+    }
+
+    ZArena(const ZArena&) = delete;
+    ZArena& operator=(const ZArena&) = delete;
+
+    /**
+     *  Objects made while a scope is alive are destroyed, in reverse order, when it ends and
+     *  their memory is reused. Scopes nest, so a draw that calls another draw is fine.
+     */
+    class Scope {
+
+    public:
+
+        Scope(ZArena& arena) : fArena(arena), fBlock(arena.fBlock), fUsed(arena.fUsed), fFinalizers(arena.fFinalizers.size()) {}
+
+        ~Scope() {
+            fArena.rewind(fBlock, fUsed, fFinalizers);
+        }
+
+    private:
+
+        ZArena& fArena;
+        size_t fBlock;
+        size_t fUsed;
+        size_t fFinalizers;
+
+    };
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            fFinalizers.push_back({ object, [](void* o) { static_cast<T*>(o)->~T(); } });
+        }
+        return object;
+    }
+
+    //Uninitialized storage for count trivial values
+    template <typename T>
+    T* makeArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arrays are not destroyed");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+private:
+
+    struct Block {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    struct Finalizer {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    void* allocate(size_t size, size_t align) {
+        for (;;) {
+            if (fBlock < fBlocks.size()) {
+                Block& block = fBlocks[fBlock];
+                uintptr_t base = (uintptr_t)block.memory.get();
+                size_t offset = ((base + fUsed + align - 1) & ~(uintptr_t)(align - 1)) - base;
+                if (offset + size <= block.size) {
+                    fUsed = offset + size;
+                    return block.memory.get() + offset;
+                }
+                //Move on to the next block, which a previous draw may have left behind
+                if (fBlock + 1 < fBlocks.size() && fBlocks[fBlock + 1].size >= size + align) {
+                    fBlock++;
+                    fUsed = 0;
+                    continue;
+                }
+            }
+            size_t blockSize = std::max(fBlocks.empty() ? fFirstBlock : fBlocks.back().size * 2, size + align);
+            Block block = { std::unique_ptr<char[]>(new char[blockSize]), blockSize };
+            size_t at = fBlocks.empty() ? 0 : fBlock + 1;
+            fBlocks.insert(fBlocks.begin() + at, std::move(block));
+            fBlock = at;
+            fUsed = 0;
+        }
+    }
+
+    void rewind(size_t block, size_t used, size_t finalizers) {
+        while (fFinalizers.size() > finalizers) {
+            fFinalizers.back().destroy(fFinalizers.back().object);
+            fFinalizers.pop_back();
+        }
+        fBlock = block;
+        fUsed = used;
+    }
+
+    std::vector<Block> fBlocks;
+    std::vector<Finalizer> fFinalizers;
+    size_t fFirstBlock;
+    size_t fBlock;
+    size_t fUsed;
+
+};
+
+#endif
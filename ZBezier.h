@@ -2,6 +2,9 @@
  * Copyright 2022 Zack Schrage
  */
 
+#ifndef ZBezier_DEFINED
+#define ZBezier_DEFINED
+
 #include "GPoint.h"
 
 typedef GPoint (*BezierFunction) (GPoint[], float);
@@ -53,8 +56,10 @@ static int numberOfCubicSegments(GPoint pts[]) {
     float x1 = (A.x() - 2 * B.x() + C.x())/2;
     float y1 = (A.y() - 2 * B.y() + C.y())/2;
     float x2 = (B.x() - 2 * C.x() + D.x())/2;
-    float y2 = (B.y() - 2 * B.y() + D.y())/2;
+    float y2 = (B.y() - 2 * C.y() + D.y())/2;
     float x = std::max(std::abs(x1), std::abs(x2));
     float y = std::max(std::abs(y1), std::abs(y2));
     return (unsigned) std::sqrt((3 * std::sqrt(x*x + y*y)) / (4 * tolerance));
-}
\ No newline at end of file
+}
+
+#endif
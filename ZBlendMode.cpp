@@ -6,6 +6,7 @@
 #include "GMath.h"
 #include "GBlendMode.h"
 #include "ZBlendMode.h"
+#include "ZSimd.h"
 
 class ZBlendMode {
 
@@ -80,10 +81,6 @@ public:
         return pixel + pixel2;
     }
 
-    static unsigned div255(unsigned x) {
-        return (x * 65793 + (1 << 23)) >> 24;
-    }
-
     //(1 - alpha) * pixel
     static GPixel scale(int alpha, GPixel pixel) {
         int a = div255((255-alpha) * GPixel_GetA(pixel));
@@ -104,230 +101,208 @@ public:
 };
 
 
-BlendFunction pickBlend(GBlendMode blendMode, unsigned int srcA) {
+/**
+ *  Each blend mode as a proc with a scalar form (one GPixel) and a vector form (Vec::N GPixels).
+ *  The vector form must produce exactly the same bits as the scalar form.
+ */
+
+struct ClearProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::clear(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Zero();
+    }
+#endif
+};
+
+struct SrcProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::src(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return s;
+    }
+#endif
+};
+
+struct DstProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::dst(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return d;
+    }
+#endif
+};
+
+struct SrcOverProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::srcOver(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Add(Vec::Scale(d, s, true), s);
+    }
+#endif
+};
+
+struct DstOverProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::dstOver(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Add(Vec::Scale(s, d, true), d);
+    }
+#endif
+};
+
+struct SrcInProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::srcIn(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Scale(s, d, false);
+    }
+#endif
+};
+
+struct DstInProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::dstIn(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Scale(d, s, false);
+    }
+#endif
+};
+
+struct SrcOutProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::srcOut(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Scale(s, d, true);
+    }
+#endif
+};
+
+struct DstOutProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::dstOut(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Scale(d, s, true);
+    }
+#endif
+};
+
+struct SrcATopProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::srcATop(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Add(Vec::Scale(d, s, true), Vec::Scale(s, d, false));
+    }
+#endif
+};
+
+struct DstATopProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::dstATop(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Add(Vec::Scale(s, d, true), Vec::Scale(d, s, false));
+    }
+#endif
+};
+
+struct XOrProc {
+    static GPixel Scalar(GPixel s, GPixel d) { return ZBlendMode::xOr(s, d); }
+#if defined(__SSE2__)
+    template <typename Vec> static typename Vec::V Vector(typename Vec::V s, typename Vec::V d) {
+        return Vec::Add(Vec::Scale(d, s, true), Vec::Scale(s, d, true));
+    }
+#endif
+};
+
+/**
+ *  One row kernel per (blend mode, source kind). A shaded source supplies count pixels; a
+ *  solid source supplies a single pixel that is hoisted out of the loop.
+ */
+template <typename Proc, bool isShader> static void blendRow(const GPixel* src, GPixel* dest, int count) {
+    int i = 0;
+#if defined(__AVX2__)
+    const ZVec8::V solid8 = ZVec8::Splat(*src);
+    for (; i + ZVec8::N <= count; i += ZVec8::N) {
+        ZVec8::V s = isShader ? ZVec8::Load(src + i) : solid8;
+        ZVec8::Store(dest + i, Proc::template Vector<ZVec8>(s, ZVec8::Load(dest + i)));
+    }
+#endif
+#if defined(__SSE2__)
+    const ZVec4::V solid4 = ZVec4::Splat(*src);
+    for (; i + ZVec4::N <= count; i += ZVec4::N) {
+        ZVec4::V s = isShader ? ZVec4::Load(src + i) : solid4;
+        ZVec4::Store(dest + i, Proc::template Vector<ZVec4>(s, ZVec4::Load(dest + i)));
+    }
+#endif
+    const GPixel solid = *src;
+    for (; i < count; i++) {
+        dest[i] = Proc::Scalar(isShader ? src[i] : solid, dest[i]);
+    }
+}
+
+//Leaves dest untouched
+template <bool isShader> static void dstRow(const GPixel* src, GPixel* dest, int count) {}
+
+template <bool isShader> static BlendFunction pickRow(GBlendMode blendMode, unsigned int srcA) {
     switch(blendMode) {
         case GBlendMode::kClear:
-            return &clearRow;;
+            return &blendRow<ClearProc, isShader>;
         case GBlendMode::kSrc:
-            return &srcRow;
+            return &blendRow<SrcProc, isShader>;
         case GBlendMode::kDst:
-            return &dstRow;
+            return &dstRow<isShader>;
         case GBlendMode::kSrcOver:
-            if (srcA == 0) return &dstRow;
-            else if (srcA == 255) return &srcRow;
-            return &srcOverRow;
+            if (srcA == 0) return &dstRow<isShader>;
+            else if (srcA == 255) return &blendRow<SrcProc, isShader>;
+            return &blendRow<SrcOverProc, isShader>;
         case GBlendMode::kDstOver:
-            if (srcA == 0) return &dstRow;
-            return &dstOverRow;
+            if (srcA == 0) return &dstRow<isShader>;
+            return &blendRow<DstOverProc, isShader>;
         case GBlendMode::kSrcIn:
-            return &srcInRow;
+            return &blendRow<SrcInProc, isShader>;
         case GBlendMode::kDstIn:
-            return &dstInRow;
+            return &blendRow<DstInProc, isShader>;
         case GBlendMode::kSrcOut:
-            return &srcOutRow;
+            return &blendRow<SrcOutProc, isShader>;
         case GBlendMode::kDstOut:
-            if (srcA == 0) return &dstRow;
-            else if (srcA == 255) return clearRow;
-            return &dstOutRow;
+            if (srcA == 0) return &dstRow<isShader>;
+            else if (srcA == 255) return &blendRow<ClearProc, isShader>;
+            return &blendRow<DstOutProc, isShader>;
         case GBlendMode::kSrcATop:
-            return &srcATopRow;
+            return &blendRow<SrcATopProc, isShader>;
         case GBlendMode::kDstATop:
-            return &dstATopRow;
+            return &blendRow<DstATopProc, isShader>;
         case GBlendMode::kXor:
-            return &xOrRow;
+            return &blendRow<XOrProc, isShader>;
         default:
-            return &clearRow;
+            return &blendRow<ClearProc, isShader>;
     }
 }
 
-static void clearRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::clear(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::clear(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::clear(isShader ? src[i] : *src, dest[i]);
-    }   
-}
-
-static void srcRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::src(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::src(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::src(isShader ? src[i] : *src, dest[i]);
-    }   
-}
-
-static void dstRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dst(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dst(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::dst(isShader ? src[i] : *src, dest[i]);
-    } 
+BlendFunction pickBlend(GBlendMode blendMode, unsigned int srcA, bool isShader) {
+    return isShader ? pickRow<true>(blendMode, srcA) : pickRow<false>(blendMode, srcA);
 }
 
-static void srcOverRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcOver(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcOver(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::srcOver(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void dstOverRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstOver(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstOver(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::dstOver(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void srcInRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcIn(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcIn(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::srcIn(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void dstInRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstIn(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstIn(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::dstIn(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void srcOutRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcOut(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcOut(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::srcOut(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void dstOutRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstOut(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstOut(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::dstOut(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void srcATopRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcATop(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::srcATop(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::srcATop(isShader ? src[i] : *src, dest[i]);
-    } 
-}
-
-static void dstATopRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstATop(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::dstATop(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::dstATop(isShader ? src[i] : *src, dest[i]);
-    } 
+//dest = src * coverage + dest * (1 - coverage)
+void lerpRow(const GPixel* src, GPixel* dest, int count, unsigned coverage) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cov = _mm_set1_epi16(coverage);
+    const __m128i invCov = _mm_set1_epi16(255 - coverage);
+    for (; i + ZVec4::N <= count; i += ZVec4::N) {
+        __m128i s = ZVec4::Load(src + i);
+        __m128i d = ZVec4::Load(dest + i);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), cov), _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invCov));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), cov), _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invCov));
+        ZVec4::Store(dest + i, _mm_packus_epi16(ZVec4::Div255(lo), ZVec4::Div255(hi)));
+    }
+#endif
+    for (; i < count; i++) {
+        unsigned a = div255(GPixel_GetA(src[i]) * coverage + GPixel_GetA(dest[i]) * (255 - coverage));
+        unsigned r = div255(GPixel_GetR(src[i]) * coverage + GPixel_GetR(dest[i]) * (255 - coverage));
+        unsigned g = div255(GPixel_GetG(src[i]) * coverage + GPixel_GetG(dest[i]) * (255 - coverage));
+        unsigned b = div255(GPixel_GetB(src[i]) * coverage + GPixel_GetB(dest[i]) * (255 - coverage));
+        dest[i] = GPixel_PackARGB(a, r, g, b);
+    }
 }
-
-static void xOrRow(GPixel* src, GPixel* dest, int count, bool isShader) {
-    // if (isShader) {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::xOr(src[i], dest[i]);
-    //     }   
-    // }
-    // else {
-    //     for (int i = 0; i < count; i++) {
-    //         dest[i] = ZBlendMode::xOr(*src, dest[i]);
-    //     }
-    // }
-    for (int i = 0; i < count; i++) {
-        dest[i] = ZBlendMode::xOr(isShader ? src[i] : *src, dest[i]);
-    } 
-}   
\ No newline at end of file
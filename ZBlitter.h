@@ -0,0 +1,227 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZBlitter_DEFINED
+#define ZBlitter_DEFINED
+
+#include "GBitmap.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GShader.h"
+#include "ZPipeline.h"
+#include "ZFill.h"
+#include "ZArena.h"
+
+/**
+ *  A blitter writes spans of the current paint into the device. One is chosen per draw call
+ *  (see ZChooseBlitter) so the rasterizers only ever hand it coordinates.
+ */
+class ZBlitter {
+
+public:
+
+    virtual ~ZBlitter() {}
+
+    //Blit [x, x + width) on row y. width must be > 0.
+    virtual void blitH(int x, int y, int width) = 0;
+
+    virtual void blitRect(int x, int y, int width, int height) {
+        for (int i = y; i < y + height; i++) {
+            blitH(x, i, width);
+        }
+    }
+
+    /**
+     *  Blit runs of partial coverage on row y. A run of runs[0] pixels with coverage
+     *  antialias[0] (0...255) starts at x, and the next run is found runs[0] entries further
+     *  into both arrays (see ZAlphaRuns). The list ends with a run of 0.
+     */
+    virtual void blitAntiH(int x, int y, const uint8_t antialias[], const int16_t runs[]) {
+        for (int n; (n = runs[0]) > 0; runs += n, antialias += n) {
+            if (antialias[0] == 255) blitH(x, y, n);
+            else if (antialias[0] > 0) blitCoverageH(x, y, n, antialias[0]);
+            x += n;
+        }
+    }
+
+    virtual bool isNullBlitter() const { return false; }
+
+protected:
+
+    virtual void blitCoverageH(int x, int y, int width, unsigned coverage) = 0;
+
+};
+
+//Group equal coverage into runs in the layout blitAntiH takes. Returns false if all zero.
+static bool buildRuns(const uint8_t alpha[], int16_t runs[], int width) {
+    bool any = false;
+    int x = 0;
+    while (x < width) {
+        int end = x + 1;
+        while (end < width && alpha[end] == alpha[x]) end++;
+        runs[x] = end - x;
+        any |= alpha[x] != 0;
+        x = end;
+    }
+    runs[width] = 0;
+    return any;
+}
+
+//Draws nothing: kDst, a failed shader context, or a solid color that cannot change the device
+class ZNullBlitter : public ZBlitter {
+
+public:
+
+    void blitH(int x, int y, int width) override {}
+    void blitRect(int x, int y, int width, int height) override {}
+    void blitAntiH(int x, int y, const uint8_t antialias[], const int16_t runs[]) override {}
+    bool isNullBlitter() const override { return true; }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {}
+
+};
+
+//The result is the paint's color regardless of the device (kSrc, kClear, opaque kSrcOver, ...)
+class ZSolidOpaqueBlitter : public ZBlitter {
+
+public:
+
+    ZSolidOpaqueBlitter(const GBitmap& device, const GPaint& paint, GPixel color) : fPipeline(device, paint), fDevice(device), fColor(color) {}
+
+    void blitH(int x, int y, int width) override {
+        fillRow(fDevice.getAddr(x, y), width, fColor, false);
+    }
+
+    void blitRect(int x, int y, int width, int height) override {
+        fillRect(fDevice.getAddr(x, y), fDevice.rowBytes() >> 2, width, height, fColor);
+    }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {
+        fPipeline.blitRowCoverage(x, x + width, y, coverage);
+    }
+
+    ZPipeline fPipeline;
+    const GBitmap& fDevice;
+    GPixel fColor;
+
+};
+
+class ZSolidBlendBlitter : public ZBlitter {
+
+public:
+
+    ZSolidBlendBlitter(const GBitmap& device, const GPaint& paint) : fPipeline(device, paint), fDevice(device) {
+        fColor = fPipeline.color();
+        fBlend = fPipeline.blend();
+    }
+
+    void blitH(int x, int y, int width) override {
+        fBlend(&fColor, fDevice.getAddr(x, y), width);
+    }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {
+        fPipeline.blitRowCoverage(x, x + width, y, coverage);
+    }
+
+    ZPipeline fPipeline;
+    const GBitmap& fDevice;
+    GPixel fColor;
+    BlendFunction fBlend;
+
+};
+
+//The shader's output replaces the device, so it can be shaded straight into the device row
+class ZShaderOpaqueBlitter : public ZBlitter {
+
+public:
+
+    ZShaderOpaqueBlitter(const GBitmap& device, const GPaint& paint) : fPipeline(device, paint), fDevice(device), fShader(paint.getShader()) {}
+
+    //In pipeline sized chunks, which keeps the shaders' per call buffers small
+    void blitH(int x, int y, int width) override {
+        GPixel* dst = fDevice.getAddr(x, y);
+        for (int i = 0; i < width; i += ZPipeline::kChunkSize) {
+            fShader->shadeRow(x + i, y, std::min((int)ZPipeline::kChunkSize, width - i), dst + i);
+        }
+    }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {
+        fPipeline.blitRowCoverage(x, x + width, y, coverage);
+    }
+
+    ZPipeline fPipeline;
+    const GBitmap& fDevice;
+    GShader* fShader;
+
+};
+
+class ZShaderBlendBlitter : public ZBlitter {
+
+public:
+
+    ZShaderBlendBlitter(const GBitmap& device, const GPaint& paint) : fPipeline(device, paint) {}
+
+    void blitH(int x, int y, int width) override {
+        fPipeline.blitRow(x, x + width, y);
+    }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {
+        fPipeline.blitRowCoverage(x, x + width, y, coverage);
+    }
+
+    ZPipeline fPipeline;
+
+};
+
+/**
+ *  Pick the cheapest blitter that produces the paint's result. This is also where the shader
+ *  receives its context, so callers only need to check for the null blitter. The blitter
+ *  lives in the arena, so it goes away with the caller's ZArena::Scope.
+ */
+static ZBlitter* ZChooseBlitter(const GBitmap& device, const GPaint& paint, const GMatrix& ctm, ZArena* arena) {
+    GBlendMode mode = paint.getBlendMode();
+    GShader* shader = paint.getShader();
+    if (mode == GBlendMode::kDst) return arena->make<ZNullBlitter>();
+
+    if (shader != nullptr) {
+        if (!shader->setContext(ctm)) return arena->make<ZNullBlitter>();
+        if (mode == GBlendMode::kSrc || (mode == GBlendMode::kSrcOver && shader->isOpaque())) {
+            return arena->make<ZShaderOpaqueBlitter>(device, paint);
+        }
+        return arena->make<ZShaderBlendBlitter>(device, paint);
+    }
+
+    GPixel color = colorToPixel(paint.getColor());
+    int alpha = GPixel_GetA(color);
+    switch (mode) {
+        case GBlendMode::kSrcOver:
+        case GBlendMode::kDstOver:
+            if (alpha == 0) return arena->make<ZNullBlitter>();
+            if (alpha == 255 && mode == GBlendMode::kSrcOver) return arena->make<ZSolidOpaqueBlitter>(device, paint, color);
+            break;
+        case GBlendMode::kDstOut:
+            if (alpha == 0) return arena->make<ZNullBlitter>();
+            if (alpha == 255) return arena->make<ZSolidOpaqueBlitter>(device, paint, 0);
+            break;
+        case GBlendMode::kSrc:
+            return arena->make<ZSolidOpaqueBlitter>(device, paint, color);
+        case GBlendMode::kClear:
+            return arena->make<ZSolidOpaqueBlitter>(device, paint, 0);
+        default:
+            break;
+    }
+    return arena->make<ZSolidBlendBlitter>(device, paint);
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZBlockedBitmap_DEFINED
+#define ZBlockedBitmap_DEFINED
+
+#include "GBitmap.h"
+#include "ZSimd.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  The texels of a bitmap laid out in 8x8 blocks, each a contiguous, cache line aligned 256
+ *  bytes, with the blocks in rows. Walking the bitmap at an angle, a row-major bitmap moves to
+ *  a new row (and usually a new cache line and page) with nearly every texel, while the blocks
+ *  keep texels that are close in both directions close in memory. The size is rounded up to
+ *  whole blocks; the texels past the bitmap's edges are never sampled.
+ *
+ *  Texel (x, y) is at
+ *      (y & ~7) * paddedWidth + (y & 7) * 8 + (x & ~7) * 8 + (x & 7)
+ *  which is a sum of a part from x and a part from y, like a row-major offset.
+ */
+class ZBlockedBitmap {
+
+public:
+
+    //Lay out the texels of bitmap, which are copied (with whether they are opaque), so later
+    //changes to them are not seen
+    void build(const GBitmap& bitmap) {
+        fWidth = bitmap.width();
+        fHeight = bitmap.height();
+        fOpaque = bitmap.isOpaque();
+        fPaddedWidth = (fWidth + 7) & ~7;
+        int paddedHeight = (fHeight + 7) & ~7;
+        //Room to start the blocks on a cache line
+        fStorage.assign((size_t)fPaddedWidth * paddedHeight + 15, 0);
+        fPixels = fStorage.data() + ((64 - ((uintptr_t)fStorage.data() & 63)) & 63) / sizeof(GPixel);
+        for (int y = 0; y < fHeight; y++) {
+            const GPixel* src = bitmap.getAddr(0, y);
+            GPixel* dst = fPixels + rowOffset(y);
+            for (int x = 0; x < fWidth; x += 8) {
+                std::copy(src + x, src + std::min(x + 8, fWidth), dst + columnOffset(x));
+            }
+        }
+    }
+
+    int width() const { return fWidth; }
+    int height() const { return fHeight; }
+    bool isOpaque() const { return fOpaque; }
+    const GPixel* pixels() const { return fPixels; }
+
+    int rowOffset(int y) const { return (y & ~7) * fPaddedWidth + ((y & 7) << 3); }
+    static int columnOffset(int x) { return ((x & ~7) << 3) + (x & 7); }
+    int index(int x, int y) const { return rowOffset(y) + columnOffset(x); }
+
+#if defined(__AVX2__)
+    //index, eight lanes at a time
+    __m256i index(__m256i x, __m256i y) const {
+        const __m256i low = _mm256_set1_epi32(7);
+        __m256i row = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_andnot_si256(low, y), _mm256_set1_epi32(fPaddedWidth)),
+                                       _mm256_slli_epi32(_mm256_and_si256(y, low), 3));
+        __m256i column = _mm256_add_epi32(_mm256_slli_epi32(_mm256_andnot_si256(low, x), 3), _mm256_and_si256(x, low));
+        return _mm256_add_epi32(row, column);
+    }
+#endif
+
+private:
+
+    int fWidth = 0;
+    int fHeight = 0;
+    int fPaddedWidth = 0;
+    bool fOpaque = false;
+    GPixel* fPixels = nullptr;
+    std::vector<GPixel> fStorage;
+
+};
+
+#endif
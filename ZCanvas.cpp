@@ -11,367 +11,620 @@
 #include "GPath.h"
 #include "GShader.h"
 #include "ZBlendMode.h"
+#include "ZBlitter.h"
+#include "ZScan.h"
+#include "ZSuperBlitter.h"
+#include "ZAccumulator.h"
+#include "ZClip.h"
+#include "ZThreadPool.h"
 #include "ZEdge.h"
 #include "ZBezier.h"
 #include "ZPath.h"
-#include "ZTriColorShader.h"
-#include "ZTriProxyShader.h"
-#include "ZComposedShader.h"
+#include "ZMeshShader.h"
+#include "ZPatch.h"
+#include "ZStroke.h"
+#include "ZHairline.h"
+#include "ZVertexCache.h"
 #include "ZGradient.h"
 
 #include <vector>
 #include <stack>
+#include <algorithm>
 #include <functional>
 #include <stdio.h>
 #include <iostream>
 
+//Rows in a tile of a threaded canvas. Tiles span the whole width, so the winding inside a
+//tile never depends on edges outside of it.
+static const int kTileRows = 64;
+
+//Bounds on the cells of a drawQuad with an adaptive level: how far (in pixels) a cell may
+//stray from the quad, how small (in pixels) one can get, and how many are on a side at most
+static const float kQuadTolerance = 0.25f;
+static const float kMinQuadCell = 4;
+static const int kMaxQuadCells = 256;
+
+//A draw recorded by a threaded canvas and rasterized at flush
+struct ZDrawOp {
+    GPaint paint;
+    GMatrix ctm;
+    size_t firstEdge; //The op's edges in fOpEdges, sorted by bucketEdges, in sub-scanlines if antiAlias
+    size_t edgeCount;
+    GIRect bounds; //The rect to fill for rect ops, otherwise only its rows are used
+    ZClip clip; //Edges and rects are already inside its bounds
+    bool antiAlias;
+    bool isRect;
+};
+
+//What one tile of a threaded flush scans with, kept between flushes
+struct ZTileBuffers {
+    std::vector<Edge> active;
+    ZAlphaRuns runs;
+    ZArena arena;
+};
+
 class ZCanvas : public GCanvas {
 
 public:
 
-    ZCanvas(const GBitmap& device) : fDevice(device) {
+    ZCanvas(const GBitmap& device, GPathEngine engine, int threads) : fDevice(device), fEngine(engine), fBatchStart(0) {
         tmStack.push(GMatrix());
+        clipStack.push({ GIRect::WH(device.width(), device.height()), nullptr });
+        if (threads > 1) {
+            fPool.reset(new ZThreadPool(threads));
+            fTiles.reset(new ZTileBuffers[(device.height() + kTileRows - 1) / kTileRows]);
+        }
+    }
+
+    ~ZCanvas() {
+        flush();
     }
 
     void drawPaint(const GPaint& paint) override {
-        GShader* shader = paint.getShader();
-        GColor color = paint.getColor();
-        GPixel src = GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
-        int alpha = GPixel_GetA(src);
-        void (*blitFunction) (const GBitmap&, const GPaint&, BlendFunction, int, int, int);
-        blitFunction = &blitDefault;
-        if (shader != nullptr) {
-            if (!shader->setContext(tmStack.top())) return;
-            if (!shader->isOpaque()) alpha = 1; //Stub alpha
-            blitFunction = &blitShader;
-        }
-        BlendFunction b = pickBlend(paint.getBlendMode(), alpha);
-        for (int i = 0; i < fDevice.height(); i++) {
-            blitFunction(fDevice, paint, b, 0, fDevice.width(), i);
-        }
+        if (clipStack.top().bounds.isEmpty()) return;
+        ZArena::Scope scope(fArena);
+        ZBlitter* blitter = ZChooseBlitter(fDevice, paint, tmStack.top(), &fArena);
+        if (blitter->isNullBlitter()) return;
+        fillRect(clipStack.top().bounds, paint, blitter);
     }
 
     void drawRect(const GRect& rect, const GPaint& paint) override {
+        const GMatrix& ctm = tmStack.top();
+        if (ctm[GMatrix::KX] == 0 && ctm[GMatrix::KY] == 0) {
+            //Still a rect on the device, so round it the way the edge walker would and blit it directly
+            GPoint corners[2] = { GPoint::Make(rect.fLeft, rect.fTop), GPoint::Make(rect.fRight, rect.fBottom) };
+            ctm.mapPoints(corners, 2);
+            GRect dr = GRect::LTRB(std::min(corners[0].x(), corners[1].x()), std::min(corners[0].y(), corners[1].y()),
+                                   std::max(corners[0].x(), corners[1].x()), std::max(corners[0].y(), corners[1].y()));
+            GIRect r = dr.round();
+            //Fractional edges need partial coverage, which the polygon scan provides
+            bool integral = r.fLeft == dr.fLeft && r.fTop == dr.fTop && r.fRight == dr.fRight && r.fBottom == dr.fBottom;
+            if (paint.isAntiAlias() && !integral) {
+                drawRectAsPolygon(rect, paint);
+                return;
+            }
+            r = intersection(r, clipStack.top().bounds);
+            if (r.isEmpty()) return;
+            ZArena::Scope scope(fArena);
+            ZBlitter* blitter = ZChooseBlitter(fDevice, paint, ctm, &fArena);
+            if (blitter->isNullBlitter()) return;
+            fillRect(r, paint, blitter);
+            return;
+        }
+        drawRectAsPolygon(rect, paint);
+    }
+
+    void drawRectAsPolygon(const GRect& rect, const GPaint& paint) {
         GPoint points[4];
         points[0] = GPoint::Make(rect.fLeft, rect.fTop);
         points[1] = GPoint::Make(rect.fRight, rect.fTop);
         points[2] = GPoint::Make(rect.fRight, rect.fBottom);
         points[3] = GPoint::Make(rect.fLeft, rect.fBottom);
         drawConvexPolygon(points, 4, paint);
-        return;
-
-        GColor color = paint.getColor();
-        GPixel src = GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
-        GRect intersect = intersection(rect, GRect::WH(fDevice.width(), fDevice.height()));
-        roundRectangle(intersect);
-        void (*blitFunction) (const GBitmap&, const GPaint&, BlendFunction, int, int, int);
-        blitFunction = &blitDefault;
-        for (int i = intersect.fTop; i < intersect.fBottom; i++) {
-            blitFunction(fDevice, paint, pickBlend(paint.getBlendMode(), GPixel_GetA(src)), intersect.fLeft, intersect.fRight, i);
-        }
     }
 
     void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
-        GShader* shader = paint.getShader();
-        GColor color = paint.getColor();
-        GPixel src = GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
-        GPoint tPoints[count];
+        if (count < 3) return;
+        fPoints.resize(count);
+        GPoint* tPoints = fPoints.data();
         tmStack.top().mapPoints(tPoints, points, count);
-        int alpha = GPixel_GetA(src);
-        void (*blitFunction) (const GBitmap&, const GPaint&, BlendFunction, int, int, int);
-        blitFunction = &blitDefault;
-        if (shader != nullptr) {
-            if (!shader->setContext(tmStack.top())) return;
-            if (!shader->isOpaque()) alpha = 1; //Stub alpha
-            blitFunction = &blitShader;
-        }
-        BlendFunction b = pickBlend(paint.getBlendMode(), alpha);
-
-        std::vector<Edge> edges = generateEdges(tPoints, count, GRect::WH(fDevice.width(), fDevice.height()));
-        if (edges.size() < 2) return;
-        std::sort(edges.begin(), edges.end(), sortLambdaFunction);
-        int upperBound = edges[0].top;
-        int lowerBound = getLowerBound(edges);
-        int leftIdx = 0;
-        int rightIdx = 1;
-        for (int i = upperBound; i < lowerBound; i++) {
-            int left = GRoundToInt((edges.at(leftIdx).m * ((float)i+0.5)) + edges.at(leftIdx).b);
-            int right = GRoundToInt((edges.at(rightIdx).m * ((float)i+0.5)) + edges.at(rightIdx).b);
-            blitFunction(fDevice, paint, b, left, right, i);
-            if (edges.at(leftIdx).bottom <= i + 1) leftIdx = std::max(leftIdx, rightIdx) + 1;
-            if (edges.at(rightIdx).bottom <= i + 1) rightIdx = std::max(leftIdx, rightIdx) + 1;
+        if (quickReject(pointBounds(tPoints, count))) return;
+        ZArena::Scope scope(fArena);
+        ZBlitter* blitter = ZChooseBlitter(fDevice, paint, tmStack.top(), &fArena);
+        if (blitter->isNullBlitter()) return;
+        fEdges.clear();
+        if (paint.isAntiAlias()) {
+            superMatrix().mapPoints(tPoints, points, count);
+            generateEdges(tPoints, count, superBounds(), fEdges);
+            fillEdges(fEdges, paint, blitter, true);
+            return;
         }
+
+        generateEdges(tPoints, count, clipBounds(), fEdges);
+        fillEdges(fEdges, paint, blitter, false);
     }
 
     void drawPath(const GPath& path, const GPaint& paint) override {
-        GShader* shader = paint.getShader();
-        GColor color = paint.getColor();
-        GPixel src = GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
-        int alpha = GPixel_GetA(src);
-        void (*blitFunction) (const GBitmap&, const GPaint&, BlendFunction, int, int, int);
-        blitFunction = &blitDefault;
-        if (shader != nullptr) {
-            if (!shader->setContext(tmStack.top())) return;
-            if (!shader->isOpaque()) alpha = 1; //Stub alpha
-            blitFunction = &blitShader;
-        }
-        BlendFunction b = pickBlend(paint.getBlendMode(), alpha);
-
-        std::vector<Edge> edges;
-        GPoint pts[GPath::kMaxNextPoints];
-        GPath pathCpy = path;
-        pathCpy.transform(tmStack.top());
-        GPath::Edger edger(pathCpy);
-        GPath::Verb v;
-        while ((v = edger.next(pts)) != GPath::kDone) {
-            switch(v) {
-                case GPath::kLine:
-                    clipper(pts[0], pts[1], GRect::WH(fDevice.width(), fDevice.height()), edges);
-                    break;
-                case GPath::kQuad:
-                    optimizeCurve(pts, NumberOfPoints::kQuadNumber, &quadBezier, &GPath::ChopQuadAt, GRect::WH(fDevice.width(), fDevice.height()), numberOfQuadSegments(pts), 0, 2, edges);
-                    break;
-                case GPath::kCubic:
-                    optimizeCurve(pts, NumberOfPoints::kCubicNumber, &cubicBezier, &GPath::ChopCubicAt, GRect::WH(fDevice.width(), fDevice.height()), numberOfCubicSegments(pts), 0, 2, edges);
-                    break;
-                default:
-                    break;
-            }
+        if (quickReject(mapBounds(path.bounds()))) return;
+        ZArena::Scope scope(fArena);
+        ZBlitter* blitter = ZChooseBlitter(fDevice, paint, tmStack.top(), &fArena);
+        if (blitter->isNullBlitter()) return;
+
+        if (fEngine == GPathEngine::kAccumulation) {
+            flush();
+            //Only the part of the path's bounds inside the clip is accumulated
+            const GIRect& clip = clipStack.top().bounds;
+            GRect bounds = mapBounds(path.bounds());
+            GRect inside = GRect::LTRB(std::max((float)clip.fLeft, bounds.fLeft), std::max((float)clip.fTop, bounds.fTop),
+                                       std::min((float)clip.fRight, bounds.fRight), std::min((float)clip.fBottom, bounds.fBottom));
+            GIRect window = intersection(inside.roundOut(), clip);
+            if (window.isEmpty()) return;
+            fAccumulator.reset(window);
+            fAccumulator.addPath(path, tmStack.top());
+            //The accumulator resolves whole rows of its window, so its spans are clipped here
+            if (!clipIsDevice()) blitter = fArena.make<ZClipBlitter>(blitter, clipStack.top(), &fArena);
+            fAccumulator.blit(blitter, paint.isAntiAlias());
+            return;
         }
-        if (edges.size() < 2) return;
-        std::sort(edges.begin(), edges.end(), sortLambdaFunction);
-
-        int upperBound = edges[0].top;
-        int lowerBound = getLowerBound(edges);
-        int numActiveEdges = 0;
-        for (int y = upperBound; y < lowerBound; y++) {
-            int w = 0;
-            int left = 0;
-            int right = 0;
-            numActiveEdges = manageActiveEdges(edges, y);
-            std::sort(edges.begin(), edges.begin() + numActiveEdges, [y](const Edge& a, const Edge& b) { 
-                return sortXLambdaFunction(a, b, y); 
-            });
-            for (int e = 0; e < numActiveEdges; e++) {
-                int x = GRoundToInt(edges[e].m*(y + 0.5) + edges[e].b);
-                if (w == 0) left = x;
-                w += edges[e].w;
-                if (w == 0) {
-                    right = x;
-                    blitFunction(fDevice, paint, b, left, right, y);
-                }
-            }
+
+        fEdges.clear();
+        if (paint.isAntiAlias()) {
+            buildPathEdges(path, superMatrix(), superDeviceBounds(), superBounds(), fEdges);
+            fillEdges(fEdges, paint, blitter, true);
+            return;
         }
+        buildPathEdges(path, tmStack.top(), deviceBounds(), clipBounds(), fEdges);
+        fillEdges(fEdges, paint, blitter, false);
     }
 
+    /**
+     *  Each vertex is mapped once, into fVertexCache, and triangles that cannot touch the clip
+     *  or have no area are dropped before anything is set up for them. The rest are scanned
+     *  straight from their corners (scanTriangle) and shaded by fMeshShader, whose gradients
+     *  are set up once per triangle. Triangles only need one of two blitters, for opaque and
+     *  for translucent shading, so a mesh allocates nothing per triangle.
+     */
     void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint& paint) override {
-        GPoint myVerts[3];
-        GColor myColors[3];
-        GPoint myTexs[3];
-        std::unique_ptr<GShader> shader;
-        std::unique_ptr<GShader> triColorShader;
-        std::unique_ptr<GShader> triProxyShader;
+        if (paint.getShader() == nullptr) texs = nullptr;
+        if (count <= 0 || (colors == nullptr && texs == nullptr)) return;
+        fMeshStats.triangles += count;
+        const ZClip& clip = clipStack.top();
+        if (clip.bounds.isEmpty()) {
+            fMeshStats.clippedOut += count;
+            return;
+        }
+        int vertexCount = 0;
+        for (int i = 0; i < count * 3; i++) {
+            vertexCount = std::max(vertexCount, indices[i] + 1);
+        }
+        fVertexCache.reset(vertexCount, tmStack.top(), GIRect::WH(fDevice.width(), fDevice.height()), clip.bounds);
+        //The mesh shader changes from triangle to triangle, so a threaded canvas draws it now
+        flush();
+        ZArena::Scope scope(fArena);
+        GPaint meshPaint(&fMeshShader);
+        meshPaint.setBlendMode(paint.getBlendMode());
+        ZBlitter* blitters[2] = { nullptr, nullptr };
+        GColor triColors[3];
+        GPoint triTexs[3];
+        GPoint deviceVerts[3];
         for (int i = 0; i < count; i++) {
-            myVerts[0] = verts[indices[3*i]];
-            myVerts[1] = verts[indices[3*i+1]];
-            myVerts[2] = verts[indices[3*i+2]];
-            if (colors != nullptr && texs != nullptr) {
-                myColors[0] = colors[indices[3*i]];
-                myColors[1] = colors[indices[3*i+1]];
-                myColors[2] = colors[indices[3*i+2]];
-                myTexs[0] = texs[indices[3*i]];
-                myTexs[1] = texs[indices[3*i+1]];
-                myTexs[2] = texs[indices[3*i+2]];
-                triColorShader = GCreateTriColorShader(myVerts, myColors);
-                triProxyShader = GCreateTriProxyShader(myVerts, myTexs, paint.getShader());
-                shader = GCreateComposedShader(triColorShader.get(), triProxyShader.get());
+            const int* index = indices + 3 * i;
+            unsigned outside = ~0u;
+            for (int j = 0; j < 3; j++) {
+                const ZMeshVertex& v = fVertexCache.get(verts, index[j]);
+                deviceVerts[j] = v.point;
+                outside &= v.outcode;
             }
-            else if (colors != nullptr) {
-                myColors[0] = colors[indices[3*i]];
-                myColors[1] = colors[indices[3*i+1]];
-                myColors[2] = colors[indices[3*i+2]];
-                shader = GCreateTriColorShader(myVerts, myColors);
+            if (outside & ZMeshVertex::kDeviceAll) {
+                fMeshStats.offDevice++;
+                continue;
             }
-            else if (texs != nullptr) {
-                myTexs[0] = texs[indices[3*i]];
-                myTexs[1] = texs[indices[3*i+1]];
-                myTexs[2] = texs[indices[3*i+2]];
-                shader = GCreateTriProxyShader(myVerts, myTexs, paint.getShader());
+            if (outside & ZMeshVertex::kClipAll) {
+                fMeshStats.clippedOut++;
+                continue;
+            }
+            for (int j = 0; j < 3; j++) {
+                if (colors) triColors[j] = colors[index[j]];
+                if (texs) triTexs[j] = texs[index[j]];
+            }
+            if (!fMeshShader.setTriangle(deviceVerts, colors ? triColors : nullptr, texs ? triTexs : nullptr, paint.getShader())) {
+                fMeshStats.degenerate++;
+                continue;
             }
-            else return;
-
-            GPath path;
-            path.moveTo(myVerts[0]);
-            path.lineTo(myVerts[1]);
-            path.lineTo(myVerts[2]);
-            drawPath(path, GPaint(shader.get()));
 
+            ZBlitter*& blitter = blitters[fMeshShader.isOpaque()];
+            if (blitter == nullptr) {
+                //The mesh shader is already in device space
+                blitter = ZChooseBlitter(fDevice, meshPaint, GMatrix(), &fArena);
+                if (!clip.isRect()) blitter = fArena.make<ZClipBlitter>(blitter, clip, &fArena);
+            }
+            scanTriangle(deviceVerts, clip.bounds, blitter);
+            fMeshStats.drawn++;
         }
+        fMeshStats.vertices += fVertexCache.transformed();
+    }
+
+    GMeshStats meshStats() const override {
+        return fMeshStats;
     }
 
+    /**
+     *  The quad is split into an n x n grid of cells, n = level + 1, and the whole grid goes to
+     *  drawMesh as one indexed mesh, so every corner is shared by the cells around it. A
+     *  negative level picks n from what the quad looks like under the CTM (adaptiveQuadLevel).
+     */
     void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) override {
-        float dWeight = 1.0/(level+1);
-        GPoint allPoints[level+2][level+2];
-        GColor allColors[level+2][level+2];
-        GPoint allTextures[level+2][level+2];
-        float weightVert = 0;
-        for (int i = 0; i < level + 2; i++) {
-            GPoint a = interpolatePoints(verts[0], verts[1], weightVert);
-            GPoint b = interpolatePoints(verts[3], verts[2], weightVert);
-            GColor colorA;
-            GColor colorB;
-            if (colors != nullptr) {
-                colorA = GColor::RGBA(colors[0].r * (1.0 - weightVert) + (colors[1].r * weightVert), colors[0].g * (1.0 - weightVert) + (colors[1].g * weightVert), colors[0].b * (1.0 - weightVert) + (colors[1].b * weightVert), colors[0].a * (1.0 - weightVert) + (colors[1].a * weightVert));
-                colorB = GColor::RGBA(colors[3].r * (1.0 - weightVert) + (colors[2].r * weightVert), colors[3].g * (1.0 - weightVert) + (colors[2].g * weightVert), colors[3].b * (1.0 - weightVert) + (colors[2].b * weightVert), colors[3].a * (1.0 - weightVert) + (colors[2].a * weightVert));
+        if (level < 0) level = adaptiveQuadLevel(verts, colors, paint.getShader() ? texs : nullptr, tmStack.top());
+        //The (level + 2) x (level + 2) grid of corners. Row i runs from the left edge (0 to 3)
+        //to the right edge (1 to 2), i / (level + 1) of the way from the top to the bottom.
+        const int n = level + 2;
+        fQuadPoints.resize(n * n);
+        fQuadColors.resize(colors ? n * n : 0);
+        fQuadTexs.resize(texs ? n * n : 0);
+        for (int i = 0; i < n; i++) {
+            float t = (float)i / (n - 1);
+            GPoint a = interpolatePoints(verts[0], verts[1], t);
+            GPoint b = interpolatePoints(verts[3], verts[2], t);
+            GColor colorA, colorB;
+            if (colors) {
+                colorA = (colors[0] * (1 - t) + colors[1] * t).pinToUnit();
+                colorB = (colors[3] * (1 - t) + colors[2] * t).pinToUnit();
             }
-            GPoint texsA;
-            GPoint texsB;
-            if (texs != nullptr) {
-                texsA = interpolatePoints(texs[0], texs[1], weightVert);
-                texsB = interpolatePoints(texs[3], texs[2], weightVert);
-            }
-            if (i == (level + 1)) {
-                a = GPoint::Make(verts[1].x(), verts[1].y());
-                b = GPoint::Make(verts[2].x(), verts[2].y());
-                if (colors != nullptr) {
-                    colorA = GColor::RGBA(colors[1].r, colors[1].g, colors[1].b, colors[1].a);
-                    colorB = GColor::RGBA(colors[2].r, colors[2].g, colors[2].b, colors[2].a);
-                }
-                if (texs != nullptr) {
-                    texsA = GPoint::Make(texs[1].x(), texs[1].y());
-                    texsB = GPoint::Make(texs[2].x(), texs[2].y());
-                }
+            GPoint texA, texB;
+            if (texs) {
+                texA = interpolatePoints(texs[0], texs[1], t);
+                texB = interpolatePoints(texs[3], texs[2], t);
             }
-            if (colors != nullptr) {
-                colorA = colorA.pinToUnit();
-                colorB = colorB.pinToUnit();
+            for (int j = 0; j < n; j++) {
+                float s = (float)j / (n - 1);
+                fQuadPoints[i * n + j] = interpolatePoints(a, b, s);
+                if (colors) fQuadColors[i * n + j] = (colorA * (1 - s) + colorB * s).pinToUnit();
+                if (texs) fQuadTexs[i * n + j] = interpolatePoints(texA, texB, s);
             }
+        }
+        drawGrid(n, colors != nullptr, texs != nullptr, paint);
+    }
 
-            float weight = 0;
-            for (int j = 0; j < level + 1; j++) {
-                allPoints[i][j] = interpolatePoints(a, b, weight);
-                if (colors != nullptr) {
-                    allColors[i][j] = GColor::RGBA(colorA.r * (1.0-weight) + (colorB.r * weight), colorA.g * (1.0-weight) + (colorB.g * weight), colorA.b * (1.0-weight) + (colorB.b * weight), colorA.a * (1.0-weight) + (colorB.a * weight));
-                    allColors[i][j] = allColors[i][j].pinToUnit();
-                }
-                if (texs != nullptr) {
-                    allTextures[i][j] = interpolatePoints(texsA, texsB, weight);
+    /**
+     *  Like drawQuad, but the grid's points come from evalCoonsPatch, which forward differences
+     *  the four curves, and the corners' colors and texs are stepped across each row.
+     */
+    void drawPatch(const GPoint cubics[12], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) override {
+        if (level < 0) level = adaptivePatchLevel(cubics, colors, paint.getShader() ? texs : nullptr, tmStack.top());
+        const int n = level + 2;
+        fQuadPoints.resize(n * n);
+        fQuadColors.resize(colors ? n * n : 0);
+        fQuadTexs.resize(texs ? n * n : 0);
+        evalCoonsPatch(cubics, n - 1, fPatch, fQuadPoints.data());
+        float h = 1.0f / (n - 1);
+        for (int i = 0; i < n; i++) {
+            float v = i * h;
+            if (colors) {
+                GColor c = colors[0] * (1 - v) + colors[3] * v;
+                GColor step = (colors[1] * (1 - v) + colors[2] * v - c) * h;
+                for (int j = 0; j < n; j++, c += step) {
+                    fQuadColors[i * n + j] = c.pinToUnit();
                 }
-                weight += dWeight;
-            }
-            allPoints[i][level + 1] = GPoint::Make(b.x(), b.y());
-            if (colors != nullptr) {
-                allColors[i][level + 1] = GColor::RGBA(colorB.r, colorB.g, colorB.b, colorB.a);
-                allColors[i][level + 1] = allColors[i][level + 1].pinToUnit();
-            }
-            if (texs != nullptr) {
-                allTextures[i][level + 1] = GPoint::Make(texsB.x(), texsB.y());
             }
-            weightVert += dWeight;
-        }
-
-        //Draw Triangles
-        for (int i = 0; i < level + 1; i++) {
-            for (int j = 0; j < level + 1; j++) {
-                int indices[3];
-                indices[0] = 0;
-                indices[1] = 1;
-                indices[2] = 2;
-
-                //Upper Half Triangle
-                GPoint verts1[3];
-                verts1[0] = allPoints[i][j];
-                verts1[1] = allPoints[i][j+1];
-                verts1[2] = allPoints[i+1][j];
-                GColor colors1[3];
-                if (colors != nullptr) {
-                    colors1[0] = allColors[i][j];
-                    colors1[1] = allColors[i][j+1];
-                    colors1[2] = allColors[i+1][j];
+            if (texs) {
+                GPoint t = interpolatePoints(texs[0], texs[3], v);
+                GVector step = (interpolatePoints(texs[1], texs[2], v) - t) * h;
+                for (int j = 0; j < n; j++, t += step) {
+                    fQuadTexs[i * n + j] = t;
                 }
-                GPoint texs1[3];
-                if (texs != nullptr) {
-                    texs1[0] = allTextures[i][j];
-                    texs1[1] = allTextures[i][j+1];
-                    texs1[2] = allTextures[i+1][j];
-                }
-
-                //Lower Half Triangle
-                GPoint verts2[3];
-                verts2[0] = allPoints[i+1][j+1];
-                verts2[1] = allPoints[i][j+1];
-                verts2[2] = allPoints[i+1][j];
-                GColor colors2[3];
-                if (colors != nullptr) {
-                    colors2[0] = allColors[i+1][j+1];
-                    colors2[1] = allColors[i][j+1];
-                    colors2[2] = allColors[i+1][j];
-                }
-                GPoint texs2[3];
-                if (texs != nullptr) {
-                    texs2[0] = allTextures[i+1][j+1];
-                    texs2[1] = allTextures[i][j+1];
-                    texs2[2] = allTextures[i+1][j];
-                }
-     
-                drawMesh(verts1, colors ? colors1 : nullptr, texs ? texs1 : nullptr, 1, indices, paint);
-                drawMesh(verts2, colors ? colors2 : nullptr, texs ? texs2 : nullptr, 1, indices, paint);
             }
         }
+        drawGrid(n, colors != nullptr, texs != nullptr, paint);
     }
 
+    /**
+     *  The outline is one contour (strokePolyline), so translucent strokes blend each pixel
+     *  once. Strokes no more than a pixel thick on the device are hairlines instead.
+     */
     void drawStroke(const GPoint points[], int count, float thickness, CapType capType, BendType bendType, const GPaint& paint) override {
-        GPath stroke;
-        GVector prev = buildNormalVector(points[0], points[1]);
-        GVector prevOrth = orthogonalizeVector(prev) * (thickness/2);
-        addCapToStroke(stroke, GPoint::Make(points[0].x(), points[0].y()), prev, prevOrth, capType, thickness);
-        for (int i = 0; i < count - 2; i++) {
-            addRectangleToStroke(stroke, points[i], points[i+1], prevOrth);
-            GVector curr = buildNormalVector(points[i+1], points[i+2]);
-            GVector currOrth = orthogonalizeVector(curr) * (thickness/2);
-            addJointToStroke(stroke, points[i+1], prev, prevOrth, curr, currOrth, bendType, thickness);
-            prev = curr;
-            prevOrth = currOrth;
-        }
-        addRectangleToStroke(stroke, points[count-2], points[count-1], prevOrth);
-        addCapToStroke(stroke, GPoint::Make(points[count-1].x(), points[count-1].y()), prev, prevOrth, capType, thickness);
+        if (isHairline(thickness)) {
+            drawHairline(points, count, paint);
+            return;
+        }
+        GPath& stroke = fStroke.reset();
+        strokePolyline(points, count, thickness / 2, capType, bendType, fStrokePoints, fStrokeDirections, stroke);
         drawPath(stroke, paint);
     }
 
+    /**
+     *  Walks each segment of the polyline on the device straight into the blitter (see
+     *  ZHairline.h), without building a path. Joins and caps are too small to matter.
+     */
+    void drawHairline(const GPoint points[], int count, const GPaint& paint) {
+        const ZClip& clip = clipStack.top();
+        if (count <= 0 || clip.bounds.isEmpty()) return;
+        //Nothing is recorded for hairlines, so a threaded canvas draws what it has first
+        flush();
+        ZArena::Scope scope(fArena);
+        ZBlitter* blitter = ZChooseBlitter(fDevice, paint, tmStack.top(), &fArena);
+        if (blitter->isNullBlitter()) return;
+        if (!clip.isRect()) blitter = fArena.make<ZClipBlitter>(blitter, clip, &fArena);
+        fStrokePoints.resize(count);
+        tmStack.top().mapPoints(fStrokePoints.data(), points, count);
+        int last[2] = { -1, -1 };
+        for (int i = 0; i + 1 < count; i++) {
+            bool includeEnd = i + 2 == count;
+            if (paint.isAntiAlias()) {
+                antiHairline(fStrokePoints[i], fStrokePoints[i + 1], includeEnd, clip.bounds, blitter);
+            } else {
+                hairline(fStrokePoints[i], fStrokePoints[i + 1], includeEnd, clip.bounds, blitter, last);
+            }
+        }
+    }
+
+    /**
+     *  A threaded canvas rasterizes the recorded draws here. Draws are batched so that each
+     *  shader appears once per batch (a shader holds one context at a time); within a batch
+     *  every tile replays the draws that touch it in order, on the thread pool.
+     */
+    void flush() override {
+        size_t start = 0;
+        while (start < fOps.size()) {
+            ZArena::Scope scope(fArena);
+            fBlitters.clear();
+            fShaders.clear();
+            size_t end = start;
+            for (; end < fOps.size(); end++) {
+                GShader* shader = fOps[end].paint.getShader();
+                if (shader != nullptr) {
+                    if (std::find(fShaders.begin(), fShaders.end(), shader) != fShaders.end()) break;
+                    fShaders.push_back(shader);
+                }
+                fBlitters.push_back(ZChooseBlitter(fDevice, fOps[end].paint, fOps[end].ctm, &fArena));
+            }
+            rasterTiles(start, end);
+            start = end;
+        }
+        fOps.clear();
+        fOpEdges.clear();
+    }
+
     void concat(const GMatrix& matrix) override {
         tmStack.top() = GMatrix::Concat(tmStack.top(), matrix);
     }
 
     void restore() override {
         tmStack.pop();
+        clipStack.pop();
     }
 
     void save() override {
         tmStack.push(tmStack.top());
+        clipStack.push(clipStack.top());
+    }
+
+    void clipRect(const GRect& rect) override {
+        const GMatrix& ctm = tmStack.top();
+        if (ctm[GMatrix::KX] != 0 || ctm[GMatrix::KY] != 0) {
+            //Rotated or skewed, so it is no longer a rect on the device
+            clipPath(GPath().addRect(rect));
+            return;
+        }
+        //Rounded like drawRect, so a clip and a fill of the same rect cover the same pixels
+        ZClip& clip = clipStack.top();
+        clip.bounds = intersection(mapBounds(rect).round(), clip.bounds);
+        if (clip.bounds.isEmpty()) clip.mask.reset();
+    }
+
+    void clipPath(const GPath& path) override {
+        ZClip& clip = clipStack.top();
+        GIRect bounds = intersection(mapBounds(path.bounds()).roundOut(), clip.bounds);
+        if (bounds.isEmpty()) {
+            clip.bounds = bounds;
+            clip.mask.reset();
+            return;
+        }
+        std::shared_ptr<ZClipMask> mask(new ZClipMask(bounds));
+        fEdges.clear();
+        buildPathEdges(path, tmStack.top(), deviceBounds(), GRect::Make(bounds), fEdges);
+        ZMaskBlitter maskBlitter(mask.get());
+        scanPath(fEdges, &maskBlitter, fScan);
+        if (clip.mask) mask->intersect(*clip.mask);
+        clip.bounds = bounds;
+        clip.mask = mask;
     }
 
     //Helper Methods
 
-    static void blitDefault(const GBitmap& fDevice, const GPaint& paint, BlendFunction b, int left, int right, int y) {
-        if (left >= right) return;
-        GPixel* p = fDevice.getAddr(left, y);
-        GColor color = paint.getColor();
-        GPixel src = GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
-        b(&src, p, right-left, false);
+    bool deferred() const {
+        return fPool != nullptr;
+    }
+
+    //The blitter and anything made for it live in the caller's arena scope
+    void fillEdges(const std::vector<Edge>& edges, const GPaint& paint, ZBlitter* blitter, bool antiAlias) {
+        if (!deferred()) {
+            //The edges are clipped to the clip's bounds, so only a mask needs the clip blitter
+            if (!clipStack.top().isRect()) blitter = fArena.make<ZClipBlitter>(blitter, clipStack.top(), &fArena);
+            if (antiAlias) scanAntiAlias(edges, blitter);
+            else scanPath(edges, blitter, fScan);
+            return;
+        }
+        ZDrawOp op;
+        int top, bottom;
+        if (!bucketEdges(edges, fScan.sorted, fScan.starts, &top, &bottom)) return;
+        op.firstEdge = fOpEdges.size();
+        op.edgeCount = fScan.sorted.size();
+        fOpEdges.insert(fOpEdges.end(), fScan.sorted.begin(), fScan.sorted.end());
+        if (antiAlias) {
+            top >>= kSuperShiftY;
+            bottom = (bottom + kSuperScaleY - 1) >> kSuperShiftY;
+        }
+        op.paint = paint;
+        op.ctm = tmStack.top();
+        op.bounds = GIRect::LTRB(0, top, fDevice.width(), bottom);
+        op.clip = clipStack.top();
+        op.antiAlias = antiAlias;
+        op.isRect = false;
+        fOps.push_back(std::move(op));
     }
 
-    static void blitShader(const GBitmap& fDevice, const GPaint& paint, BlendFunction b, int left, int right, int y) {
-        if (left >= right) return;
-        GPixel newPixels[right-left];
-        paint.getShader()->shadeRow(left, y, right-left, newPixels);
-        GPixel* p = fDevice.getAddr(left, y);
-        b(newPixels, p, right-left, true);
+    void fillRect(const GIRect& r, const GPaint& paint, ZBlitter* blitter) {
+        if (!deferred()) {
+            if (!clipStack.top().isRect()) blitter = fArena.make<ZClipBlitter>(blitter, clipStack.top(), &fArena);
+            blitter->blitRect(r.fLeft, r.fTop, r.width(), r.height());
+            return;
+        }
+        ZDrawOp op;
+        op.firstEdge = 0;
+        op.edgeCount = 0;
+        op.paint = paint;
+        op.ctm = tmStack.top();
+        op.bounds = r;
+        op.clip = clipStack.top();
+        op.antiAlias = false;
+        op.isRect = true;
+        fOps.push_back(std::move(op));
+    }
+
+    //Bin the ops of one batch (with blitters in fBlitters) into tiles and rasterize the tiles in parallel
+    void rasterTiles(size_t start, size_t end) {
+        int tiles = (fDevice.height() + kTileRows - 1) / kTileRows;
+        fBins.resize(tiles);
+        for (std::vector<size_t>& bin : fBins) {
+            bin.clear();
+        }
+        for (size_t i = start; i < end; i++) {
+            const GIRect& b = fOps[i].bounds;
+            if (b.isEmpty() || fBlitters[i - start]->isNullBlitter()) continue;
+            for (int t = b.fTop / kTileRows; t <= (b.fBottom - 1) / kTileRows; t++) {
+                fBins[t].push_back(i);
+            }
+        }
+        fBatchStart = start;
+        //Capturing only this keeps the task small enough for std::function to not allocate
+        fPool->run(tiles, [this](int t) { rasterTile(t); });
+    }
+
+    void rasterTile(int t) {
+        int top = t * kTileRows;
+        int bottom = std::min(top + kTileRows, fDevice.height());
+        ZTileBuffers& buffers = fTiles[t];
+        for (size_t i : fBins[t]) {
+            const ZDrawOp& op = fOps[i];
+            ZBlitter* blitter = fBlitters[i - fBatchStart];
+            ZArena::Scope scope(buffers.arena);
+            if (!op.clip.isRect()) blitter = buffers.arena.make<ZClipBlitter>(blitter, op.clip, &buffers.arena);
+            const Edge* edges = fOpEdges.data() + op.firstEdge;
+            if (op.isRect) {
+                int y0 = std::max(top, op.bounds.fTop);
+                int y1 = std::min(bottom, op.bounds.fBottom);
+                blitter->blitRect(op.bounds.fLeft, y0, op.bounds.width(), y1 - y0);
+            }
+            else if (op.antiAlias) {
+                ZSuperBlitter superBlitter(blitter, fDevice.width(), &buffers.runs);
+                scanRows<kSuperShiftX>(edges, op.edgeCount, top << kSuperShiftY, bottom << kSuperShiftY, &superBlitter, buffers.active);
+            }
+            else {
+                scanRows(edges, op.edgeCount, top, bottom, blitter, buffers.active);
+            }
+        }
+    }
+
+    //Anti-aliased fills build their edges in sub-scanlines, kSuperScaleY per device row
+    GMatrix superMatrix() const {
+        return GMatrix::Concat(GMatrix::Scale(1, kSuperScaleY), tmStack.top());
+    }
+
+    GRect superBounds() const {
+        const GIRect& b = clipStack.top().bounds;
+        return GRect::LTRB(b.fLeft, b.fTop * kSuperScaleY, b.fRight, b.fBottom * kSuperScaleY);
+    }
+
+    bool clipIsDevice() const {
+        const ZClip& clip = clipStack.top();
+        return clip.isRect() && clip.bounds.fLeft == 0 && clip.bounds.fTop == 0 &&
+               clip.bounds.fRight == fDevice.width() && clip.bounds.fBottom == fDevice.height();
+    }
+
+    GRect deviceBounds() const {
+        return GRect::WH(fDevice.width(), fDevice.height());
+    }
+
+    GRect superDeviceBounds() const {
+        return GRect::WH(fDevice.width(), fDevice.height() * kSuperScaleY);
+    }
+
+    GRect clipBounds() const {
+        return GRect::Make(clipStack.top().bounds);
+    }
+
+    //True if nothing inside of the device space bounds can be drawn
+    bool quickReject(const GRect& bounds) const {
+        const GIRect& clip = clipStack.top().bounds;
+        return clip.isEmpty() || bounds.fRight <= clip.fLeft || bounds.fLeft >= clip.fRight ||
+               bounds.fBottom <= clip.fTop || bounds.fTop >= clip.fBottom;
+    }
+
+    //The device space bounds of a rect under the CTM
+    GRect mapBounds(const GRect& rect) const {
+        GPoint corners[4] = {
+            GPoint::Make(rect.fLeft, rect.fTop), GPoint::Make(rect.fRight, rect.fTop),
+            GPoint::Make(rect.fRight, rect.fBottom), GPoint::Make(rect.fLeft, rect.fBottom),
+        };
+        tmStack.top().mapPoints(corners, 4);
+        return pointBounds(corners, 4);
+    }
+
+    static GRect pointBounds(const GPoint points[], int count) {
+        GRect bounds = GRect::LTRB(points[0].x(), points[0].y(), points[0].x(), points[0].y());
+        for (int i = 1; i < count; i++) {
+            bounds.fLeft = std::min(bounds.fLeft, points[i].x());
+            bounds.fTop = std::min(bounds.fTop, points[i].y());
+            bounds.fRight = std::max(bounds.fRight, points[i].x());
+            bounds.fBottom = std::max(bounds.fBottom, points[i].y());
+        }
+        return bounds;
+    }
+
+    void scanAntiAlias(const std::vector<Edge>& edges, ZBlitter* blitter) {
+        ZSuperBlitter superBlitter(blitter, fDevice.width(), &fRuns);
+        scanPath<kSuperShiftX>(edges, &superBlitter, fScan);
+    }
+
+    /**
+     *  Curves are flattened based on the device bounds, so the clip (which the edges are
+     *  clipped to) never changes the pixels a path covers inside of it.
+     *
+     *  The path is never copied: each segment is mapped by the matrix as the edger reaches
+     *  it, and segments above or below the clip are dropped before they are flattened.
+     */
+    static void buildPathEdges(const GPath& path, const GMatrix& matrix, GRect bounds, GRect clip, std::vector<Edge>& edges) {
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Edger edger(path);
+        GPath::Verb v;
+        while ((v = edger.next(pts)) != GPath::kDone) {
+            switch(v) {
+                case GPath::kLine:
+                    if (!mapSegment(matrix, pts, 2, clip.fTop, clip.fBottom)) break;
+                    clipper(pts[0], pts[1], clip, edges);
+                    break;
+                case GPath::kQuad:
+                    if (!mapSegment(matrix, pts, NumberOfPoints::kQuadNumber, clip.fTop, clip.fBottom)) break;
+                    optimizeCurve(pts, NumberOfPoints::kQuadNumber, &quadBezier, &GPath::ChopQuadAt, bounds, clip, numberOfQuadSegments(pts), 0, 2, edges);
+                    break;
+                case GPath::kCubic:
+                    if (!mapSegment(matrix, pts, NumberOfPoints::kCubicNumber, clip.fTop, clip.fBottom)) break;
+                    optimizeCurve(pts, NumberOfPoints::kCubicNumber, &cubicBezier, &GPath::ChopCubicAt, bounds, clip, numberOfCubicSegments(pts), 0, 2, edges);
+                    break;
+                default:
+                    break;
+            }
+        }
     }
 
     static GRect intersection(GRect r1, GRect r2) {
         return GRect::LTRB(std::max(r1.fLeft, r2.fLeft), std::max(r1.fTop, r2.fTop), std::min(r1.fRight, r2.fRight),  std::min(r1.fBottom, r2.fBottom));
     }
 
+    static GIRect intersection(GIRect r1, GIRect r2) {
+        return GIRect::LTRB(std::max(r1.fLeft, r2.fLeft), std::max(r1.fTop, r2.fTop), std::min(r1.fRight, r2.fRight),  std::min(r1.fBottom, r2.fBottom));
+    }
+
     static void roundRectangle(GRect& rect) {
         rect.fTop = GRoundToInt(rect.fTop);
         rect.fLeft = GRoundToInt(rect.fLeft);
@@ -379,13 +632,11 @@ public:
         rect.fBottom = GRoundToInt(rect.fBottom);
     }
 
-    static std::vector<Edge> generateEdges(const GPoint points[], int count, GRect bounds) {
-        std::vector<Edge> edges;
+    static void generateEdges(const GPoint points[], int count, GRect bounds, std::vector<Edge>& edges) {
         for (int i = 0; i < count - 1; i++) {
             clipper(points[i], points[i+1], bounds, edges);
         }
-        clipper(points[0], points[count-1], bounds, edges);
-        return edges;
+        clipper(points[count-1], points[0], bounds, edges);
     }
 
     static void clipper(GPoint p1, GPoint p2, GRect bounds, std::vector<Edge>& edges) {
@@ -399,6 +650,8 @@ public:
             p1 = p2;
             p2 = temp;
         }
+        //The row the whole line starts on, which its x is stepped from
+        int anchor = GRoundToInt(p1.y());
         //Top Cases
         if (p2.y() < bounds.fTop) return;
         if (p1.y() < bounds.fTop) p1.set(m*bounds.fTop + b, bounds.fTop);
@@ -446,13 +699,15 @@ public:
             if (isNotHorizontal(p2, p3)) edges.push_back(createEdge(p2, p3, w));
         }
         if (isNotHorizontal(p1, p2)) {
-            edges.push_back(createEdge(p1, p2, w, m, b));
+            Edge e = createEdge(p1, p2, w, m, b);
+            seekEdge(e, e.top, anchor);
+            edges.push_back(e);
         }
     }
 
-    static void optimizeCurve(GPoint pts[], int numPts, BezierFunction bezierFunction, ChopperFunction chopperFunction, GRect bounds, int segments, int n, int nMax, std::vector<Edge> &edges) {
+    static void optimizeCurve(GPoint pts[], int numPts, BezierFunction bezierFunction, ChopperFunction chopperFunction, GRect bounds, GRect clip, int segments, int n, int nMax, std::vector<Edge> &edges) {
         if (n >= nMax || verticalBoundedness(pts, numPts, bounds, true)) {
-            segmenter(pts, numPts, bezierFunction, bounds, segments >> n, edges);
+            segmenter(pts, numPts, bezierFunction, clip, segments >> n, edges);
             return;
         }
         else if (verticalBoundedness(pts, numPts, bounds, false)) {
@@ -471,8 +726,8 @@ public:
             right[i] = halfCurves[numPts - 1 + i];
         }
 
-        optimizeCurve(left, numPts, bezierFunction, chopperFunction, bounds, segments, n++, nMax, edges);
-        optimizeCurve(right, numPts, bezierFunction, chopperFunction, bounds, segments, n++, nMax, edges);
+        optimizeCurve(left, numPts, bezierFunction, chopperFunction, bounds, clip, segments, n++, nMax, edges);
+        optimizeCurve(right, numPts, bezierFunction, chopperFunction, bounds, clip, segments, n++, nMax, edges);
     }
 
     static void segmenter(GPoint pts[], int numPts, BezierFunction bezierFunction, GRect bounds, int segments, std::vector<Edge> &edges) {
@@ -482,164 +737,177 @@ public:
             clipper(prev, last, bounds, edges);
             return;
         }
-        float t = 0.0;
         float dt = 1.0/segments;
-        for (int i = 0; i < segments - 1; i++) {
-            GPoint newPoint = bezierFunction(pts, t);
+        for (int i = 1; i < segments; i++) {
+            GPoint newPoint = bezierFunction(pts, i * dt);
             clipper(prev, newPoint, bounds, edges);
             prev = newPoint;
-            t += dt;
         }
         clipper(prev, last, bounds, edges);
     }
 
-    static GVector buildNormalVector(GPoint p0, GPoint p1) {
-        GVector vector;
-        vector.set(p1.x() - p0.x(), p1.y() - p0.y());
-        float invLength = 1 / vector.length();
-        vector.set(vector.x() * invLength, vector.y() * invLength);
-        return vector;
-    }
-
-    static GVector orthogonalizeVector(GVector vector) {
-        GVector orthogonal;
-        orthogonal.set(-vector.y(), vector.x());
-        return orthogonal;
-    }
-
-    static void addRectangleToStroke(GPath& stroke, GPoint p0, GPoint p1, GVector constructionVector) {
-        stroke.moveTo(p0.x() + constructionVector.x(), p0.y() + constructionVector.y());
-        stroke.lineTo(p1.x() + constructionVector.x(), p1.y() + constructionVector.y());
-        stroke.lineTo(p1.x() - constructionVector.x(), p1.y() - constructionVector.y());
-        stroke.lineTo(p0.x() - constructionVector.x(), p0.y() - constructionVector.y());
-    }
-
-    static void addCapToStroke(GPath& stroke, GPoint p, GVector prev, GVector prevOrth, GCanvas::CapType capType, int thickness) {
-        switch (capType) {
-            case Circle:
-                stroke.moveTo(p.x(), p.y());
-                stroke.addCircle(GPoint::Make(p.x(), p.y()), thickness, GPath::kCCW_Direction);
-                break;
-            case Square:
-                GVector reverseNormal;
-                reverseNormal.set(-prev.x() * thickness, -prev.y() * thickness);
-                stroke.moveTo(p.x() - prevOrth.x() + reverseNormal.x(), p.y() - prevOrth.y() + reverseNormal.y());
-                stroke.lineTo(p.x() + prevOrth.x() + reverseNormal.x(), p.y() + prevOrth.y() + reverseNormal.y());
-                stroke.lineTo(p.x() + prevOrth.x() - reverseNormal.x(), p.y() + prevOrth.y() - reverseNormal.y());
-                stroke.lineTo(p.x() - prevOrth.x() - reverseNormal.x(), p.y() - prevOrth.y() - reverseNormal.y());
-                break;
-        }
-    }
-
-    static void addJointToStroke(GPath& stroke, GPoint p, GVector prev, GVector prevOrth, GVector curr, GVector currOrth, GCanvas::BendType bendType, int thickness) {
-        float cross = (prev.x() * curr.y()) - (prev.y() * curr.x());
-        switch (bendType) {
-            case Rounded:
-                stroke.moveTo(p.x(), p.y());
-                stroke.addCircle(GPoint::Make(p.x(), p.y()), thickness/2, GPath::kCCW_Direction);
-                break;
-            case Bend:
-                if (cross >= 0) {
-                    stroke.moveTo(p.x(), p.y());
-                    stroke.lineTo(p.x() - prevOrth.x(), p.y() - prevOrth.y());
-                    stroke.lineTo(p.x() - currOrth.x(), p.y() - currOrth.y());
-                }
-                else {
-                    stroke.moveTo(p.x(), p.y());
-                    stroke.lineTo(p.x() + currOrth.x(), p.y() + currOrth.y());
-                    stroke.lineTo(p.x() + prevOrth.x(), p.y() + prevOrth.y());
-                }
-                break;
-            case Miter:
-                GVector Q;
-                Q.set(prev.x() - curr.x(), prev.y() - curr.y());
-                Q = Q * (1 / Q.length());
-                float dot = (prev.x() * curr.x()) + (prev.y() * curr.y());
-                float q = (thickness/2) * std::sqrt(2.0/(1-dot));
-                Q = Q * q;
-                // stroke.moveTo(p.x() + Q.x(), p.y() + Q.y());
-                // stroke.addCircle(GPoint::Make(p.x() + Q.x(), p.y() + Q.y()), thickness/3, GPath::kCCW_Direction);
-                if (cross >= 0) {
-                    stroke.moveTo(p.x(), p.y());
-                    stroke.lineTo(p.x() - currOrth.x(), p.y() - currOrth.y());
-                    stroke.lineTo(p.x() + Q.x(), p.y() + Q.y());
-                    stroke.lineTo(p.x() - prevOrth.x(), p.y() - prevOrth.y());
-                }
-                else {
-                    stroke.moveTo(p.x(), p.y());
-                    stroke.lineTo(p.x() + prevOrth.x(), p.y() + prevOrth.y());
-                    stroke.lineTo(p.x() + Q.x(), p.y() + Q.y());
-                    stroke.lineTo(p.x() + currOrth.x(), p.y() + currOrth.y());
-                }
-                break;
+    static bool isNotHorizontal(GPoint p1, GPoint p2) {
+        return GRoundToInt(p1.y()) != GRoundToInt(p2.y());
+    }
+
+    static bool verticalBoundedness(GPoint pts[], int numPts, GRect bounds, bool within) {
+        for (int i = 0; i < numPts; i++) {
+            bool inBounds = pts[i].y() < bounds.fBottom && pts[i].y() >= bounds.fTop;
+            if (within && !inBounds) return false;
+            else if (!within && inBounds) return false;
         }
+        return true;
     }
 
-    static int manageActiveEdges(std::vector<Edge>& edges, int y) {
-        int count = 0;
-        for (int i = 0; i < edges.size(); i++) {
-            if (edges[i].top > y + 0.5) break;
-            if (y + 0.5 >= edges[i].top && y + 0.5 <= edges[i].bottom) {
-                edges[i].top = y;
-                count++;
-            }
-            else {
-                edges.erase(edges.begin() + i);
-                i--;
+    /**
+     *  Draw the n x n grid of corners in fQuadPoints (and fQuadColors and fQuadTexs) as one
+     *  indexed mesh, two triangles per cell, split on the diagonal from (i, j + 1) to
+     *  (i + 1, j).
+     */
+    void drawGrid(int n, bool colors, bool texs, const GPaint& paint) {
+        fQuadIndices.resize(6 * (n - 1) * (n - 1));
+        int* index = fQuadIndices.data();
+        for (int i = 0; i < n - 1; i++) {
+            for (int j = 0; j < n - 1; j++) {
+                int corner = i * n + j;
+                index[0] = corner;
+                index[1] = corner + 1;
+                index[2] = corner + n;
+                index[3] = corner + n + 1;
+                index[4] = corner + 1;
+                index[5] = corner + n;
+                index += 6;
             }
         }
-        return count;
+        drawMesh(fQuadPoints.data(), colors ? fQuadColors.data() : nullptr, texs ? fQuadTexs.data() : nullptr,
+                 2 * (n - 1) * (n - 1), fQuadIndices.data(), paint);
     }
 
-    static bool sortLambdaFunction(Edge i, Edge j) { 
-        if (i.top < j.top) return true;
-        else if (i.top > j.top) return false; 
-        else {
-            if (i.left < j.left) return true;
-            else if (i.left > j.left) return false;
-            else return i.m < j.m;
-        }
+    //Zero thickness, or at most a pixel once the CTM has scaled it
+    bool isHairline(float thickness) const {
+        const GMatrix& ctm = tmStack.top();
+        float scaleX = std::sqrt(ctm[GMatrix::SX] * ctm[GMatrix::SX] + ctm[GMatrix::KY] * ctm[GMatrix::KY]);
+        float scaleY = std::sqrt(ctm[GMatrix::KX] * ctm[GMatrix::KX] + ctm[GMatrix::SY] * ctm[GMatrix::SY]);
+        return thickness >= 0 && thickness * std::max(scaleX, scaleY) <= 1;
     }
 
-    static bool sortXLambdaFunction(Edge i, Edge j, int y) {
-        if (((i.m * (y+0.5)) + i.b) < ((j.m * (y+0.5)) + j.b)) return true;
-        else return false;
+    static GPoint interpolatePoints(GPoint a, GPoint b, float t) {
+        return (a * (1-t)) + (b * t);
     }
 
-    static int getLowerBound(const std::vector<Edge>& edges) {
-        int lower = edges[0].bottom;
-        for (int i = 1; i < edges.size(); i++) {
-            lower = std::max(lower, edges[i].bottom);
-        }
-        return lower;
+    /**
+     *  The level drawQuad uses when it is given a negative one. Splitting a side of the quad
+     *  into n makes each cell 1/n of the quad in both directions, and a triangle strays from
+     *  the bilinear quad by at most |twist| / (4 * n * n), where the twist is
+     *  c0 - c1 + c2 - c3 of the corners' points, texture coordinates or colors.
+     */
+    static int adaptiveQuadLevel(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], const GMatrix& ctm) {
+        GPoint device[4];
+        ctm.mapPoints(device, verts, 4);
+        float size = 0;
+        for (int i = 0; i < 4; i++) {
+            size = std::max(size, (device[(i + 1) % 4] - device[i]).length());
+        }
+        return adaptiveLevel(cornerTwist(device, colors, texs, ctm), size);
     }
 
-    static bool isNotHorizontal(GPoint p1, GPoint p2) {
-        return GRoundToInt(p1.y()) != GRoundToInt(p2.y());
+    /**
+     *  The level drawPatch uses when it is given a negative one: enough cells for the corners'
+     *  twist (as for a quad) and for each side, as a cubic strays from n chords by at most
+     *  3/4 of its largest second difference / (n * n).
+     */
+    static int adaptivePatchLevel(const GPoint cubics[12], const GColor colors[4], const GPoint texs[4], const GMatrix& ctm) {
+        GPoint device[12];
+        ctm.mapPoints(device, cubics, 12);
+        const GPoint corners[4] = { device[0], device[3], device[6], device[9] };
+        float twist = cornerTwist(corners, colors, texs, ctm);
+        float size = 0;
+        for (int side = 0; side < 4; side++) {
+            const GPoint* p = device + side * 3;
+            const GPoint& last = side == 3 ? device[0] : p[3];
+            size = std::max(size, (p[1] - p[0]).length() + (p[2] - p[1]).length() + (last - p[2]).length());
+            float bend = std::max(((p[0] - p[1]) + (p[2] - p[1])).length(), ((p[1] - p[2]) + (last - p[2])).length());
+            twist = std::max(twist, 3 * bend);
+        }
+        return adaptiveLevel(twist, size);
     }
 
-    static bool verticalBoundedness(GPoint pts[], int numPts, GRect bounds, bool within) {
-        for (int i = 0; i < numPts; i++) {
-            bool inBounds = pts[i].y() < bounds.fBottom && pts[i].y() >= bounds.fTop;
-            if (within && !inBounds) return false;
-            else if (!within && inBounds) return false;
-        }
-        return true;
+    //The twist of the device corners, and of the colors and texs at them, in device pixels
+    static float cornerTwist(const GPoint device[4], const GColor colors[4], const GPoint texs[4], const GMatrix& ctm) {
+        float twist = ((device[0] - device[1]) + (device[2] - device[3])).length();
+        if (texs) {
+            //Texture coordinates are in the space the CTM maps to the device
+            GVector t = (texs[0] - texs[1]) + (texs[2] - texs[3]);
+            GVector mapped = { ctm[GMatrix::SX] * t.x() + ctm[GMatrix::KX] * t.y(), ctm[GMatrix::KY] * t.x() + ctm[GMatrix::SY] * t.y() };
+            twist = std::max(twist, mapped.length());
+        }
+        if (colors) {
+            //A pixel's worth of error in a color is 1/255
+            GColor c = colors[0] - colors[1] + colors[2] - colors[3];
+            float most = std::max(std::max(std::abs(c.r), std::abs(c.g)), std::max(std::abs(c.b), std::abs(c.a)));
+            twist = std::max(twist, most * 255 * kQuadTolerance);
+        }
+        return twist;
     }
 
-    static GPoint interpolatePoints(GPoint a, GPoint b, float t) {
-        return (a * (1-t)) + (b * t);
+    /**
+     *  The level whose cells keep an error of twist / (4 * n * n) below kQuadTolerance, but
+     *  are never made smaller than kMinQuadCell pixels across (size is the longest side on
+     *  the device), with at most kMaxQuadCells of them on a side.
+     */
+    static int adaptiveLevel(float twist, float size) {
+        float n = std::sqrt(twist / (4 * kQuadTolerance));
+        n = std::min(n, size / kMinQuadCell);
+        if (!(n > 1)) return 0;
+        return (int)std::ceil(std::min(n, (float)kMaxQuadCells)) - 1;
     }
 
 private:
     
     const GBitmap fDevice; // Store a copy of the bitmap
-    std::stack<GMatrix> tmStack; // Store a stack of transformation matrices
+    std::stack<GMatrix, std::vector<GMatrix>> tmStack; // Store a stack of transformation matrices
+    std::stack<ZClip, std::vector<ZClip>> clipStack; // The clip for each matrix in tmStack
+    GPathEngine fEngine;
+    ZAccumulator fAccumulator; // Area buffer for the accumulation engine, kept between paths
+    std::unique_ptr<ZThreadPool> fPool; // Only for threaded canvases
+    std::vector<ZDrawOp> fOps; // Draws recorded since the last flush
+    std::vector<Edge> fOpEdges; // The edges of every op in fOps
+    std::vector<ZBlitter*> fBlitters; // Blitters for the batch being flushed, in fArena
+    std::vector<GShader*> fShaders; // Shaders in the batch being flushed
+    std::vector<std::vector<size_t>> fBins; // The ops touching each tile
+    std::unique_ptr<ZTileBuffers[]> fTiles; // One per tile, for threaded canvases
+    size_t fBatchStart;
+
+    //Scratch kept between draws, so drawing stops allocating once they have grown to fit
+    ZArena fArena; // Blitters and their buffers, scoped to a draw
+    ZScanBuffers fScan;
+    ZAlphaRuns fRuns;
+    std::vector<Edge> fEdges;
+    std::vector<GPoint> fPoints;
+    std::vector<GPoint> fQuadPoints;
+    std::vector<GColor> fQuadColors;
+    std::vector<GPoint> fQuadTexs;
+    std::vector<int> fQuadIndices;
+    ZPatchBuffers fPatch;
+    ZMeshShader fMeshShader;
+    ZVertexCache fVertexCache;
+    GMeshStats fMeshStats;
+    GPath fStroke;
+    std::vector<GPoint> fStrokePoints;
+    std::vector<GVector> fStrokeDirections;
 
 };
 
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device) {
-    return std::unique_ptr<GCanvas>(new ZCanvas(device));
+    return std::unique_ptr<GCanvas>(new ZCanvas(device, GPathEngine::kEdgeList, 1));
+}
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device, GPathEngine engine) {
+    return std::unique_ptr<GCanvas>(new ZCanvas(device, engine, 1));
+}
+
+std::unique_ptr<GCanvas> GCreateThreadedCanvas(const GBitmap& device, int threads) {
+    return std::unique_ptr<GCanvas>(new ZCanvas(device, GPathEngine::kEdgeList, threads));
 }
 
 std::string GDrawSomething(GCanvas* canvas, GISize dim);
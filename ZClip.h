@@ -0,0 +1,163 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZClip_DEFINED
+#define ZClip_DEFINED
+
+#include "GRect.h"
+#include "ZBlitter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/**
+ *  Which pixels of a clip's bounds are inside it, one byte per pixel (0 or 255). Masks are
+ *  never changed once built, so a save() shares its mask instead of copying it.
+ */
+class ZClipMask {
+
+public:
+
+    ZClipMask(const GIRect& bounds) : fBounds(bounds), fCoverage((size_t)bounds.width() * bounds.height(), 0) {}
+
+    const GIRect& bounds() const { return fBounds; }
+
+    //Row y of the mask, indexed by device x
+    uint8_t* row(int y) {
+        return fCoverage.data() + (size_t)(y - fBounds.fTop) * fBounds.width() - fBounds.fLeft;
+    }
+
+    const uint8_t* row(int y) const {
+        return fCoverage.data() + (size_t)(y - fBounds.fTop) * fBounds.width() - fBounds.fLeft;
+    }
+
+    //Keep only the pixels that are also inside other, which covers at least these bounds
+    void intersect(const ZClipMask& other) {
+        for (int y = fBounds.fTop; y < fBounds.fBottom; y++) {
+            uint8_t* dst = row(y);
+            const uint8_t* src = other.row(y);
+            for (int x = fBounds.fLeft; x < fBounds.fRight; x++) {
+                dst[x] = std::min(dst[x], src[x]);
+            }
+        }
+    }
+
+private:
+
+    GIRect fBounds;
+    std::vector<uint8_t> fCoverage;
+
+};
+
+/**
+ *  The device clip. bounds holds every pixel that can be drawn, so draws are rejected and
+ *  their edges clipped against it. A clip that is not a rect on the device also has a mask.
+ */
+struct ZClip {
+    GIRect bounds;
+    std::shared_ptr<const ZClipMask> mask;
+
+    bool isRect() const { return !mask; }
+};
+
+//Rasterizes a clip path into a mask
+class ZMaskBlitter : public ZBlitter {
+
+public:
+
+    ZMaskBlitter(ZClipMask* mask) : fMask(mask) {}
+
+    void blitH(int x, int y, int width) override {
+        std::memset(fMask->row(y) + x, 255, width);
+    }
+
+protected:
+
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {
+        std::memset(fMask->row(y) + x, coverage, width);
+    }
+
+    ZClipMask* fMask;
+
+};
+
+/**
+ *  Passes on only the parts of spans that are inside the clip. Edges are already clipped to
+ *  the clip's bounds, so this is only needed for masks and for rasterizers that can produce
+ *  spans outside of the bounds.
+ */
+class ZClipBlitter : public ZBlitter {
+
+public:
+
+    ZClipBlitter(ZBlitter* blitter, const ZClip& clip, ZArena* arena) : fBlitter(blitter), fBounds(clip.bounds), fMask(clip.mask.get()) {
+        fAlpha = arena->makeArray<uint8_t>(fBounds.width() + 1);
+        fRuns = arena->makeArray<int16_t>(fBounds.width() + 1);
+    }
+
+    void blitH(int x, int y, int width) override {
+        if (y < fBounds.fTop || y >= fBounds.fBottom) return;
+        int left = std::max(x, fBounds.fLeft);
+        int right = std::min(x + width, fBounds.fRight);
+        if (!fMask) {
+            if (left < right) fBlitter->blitH(left, y, right - left);
+            return;
+        }
+        //Blit each run of covered pixels
+        const uint8_t* mask = fMask->row(y);
+        while (left < right) {
+            while (left < right && mask[left] == 0) left++;
+            int end = left;
+            while (end < right && mask[end] != 0) end++;
+            if (end > left) fBlitter->blitH(left, y, end - left);
+            left = end;
+        }
+    }
+
+    //Expand the runs to one alpha per pixel, scale by the mask and group them again
+    void blitAntiH(int x, int y, const uint8_t antialias[], const int16_t runs[]) override {
+        if (y < fBounds.fTop || y >= fBounds.fBottom) return;
+        uint8_t* alpha = fAlpha - fBounds.fLeft;
+        int left = std::max(x, fBounds.fLeft);
+        int right = left;
+        for (int n; (n = runs[0]) > 0; runs += n, antialias += n) {
+            int start = std::max(x, fBounds.fLeft);
+            int stop = std::min(x + n, fBounds.fRight);
+            if (start < stop) {
+                std::memset(alpha + start, antialias[0], stop - start);
+                right = stop;
+            }
+            x += n;
+        }
+        if (left >= right) return;
+        if (fMask) {
+            const uint8_t* mask = fMask->row(y);
+            for (int i = left; i < right; i++) {
+                alpha[i] = (alpha[i] * mask[i] + 127) / 255;
+            }
+        }
+        int16_t* clippedRuns = fRuns + (left - fBounds.fLeft);
+        if (buildRuns(alpha + left, clippedRuns, right - left)) {
+            fBlitter->blitAntiH(left, y, alpha + left, clippedRuns);
+        }
+    }
+
+protected:
+
+    //Spans always arrive through blitH and blitAntiH
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {}
+
+private:
+
+    ZBlitter* fBlitter;
+    GIRect fBounds;
+    const ZClipMask* fMask;
+    uint8_t* fAlpha;
+    int16_t* fRuns;
+
+};
+
+#endif
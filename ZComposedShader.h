@@ -1,5 +0,0 @@
-#include "GColor.h"
-#include "GPoint.h"
-#include "GShader.h"
-
-std::unique_ptr<GShader> GCreateComposedShader(GShader* triColorShader, GShader* triBMShader);
\ No newline at end of file
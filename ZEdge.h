@@ -2,6 +2,9 @@
  *  Copyright 2022 Zack Schrage
  */
 
+#ifndef ZEdge_DEFINED
+#define ZEdge_DEFINED
+
 #include "GPoint.h"
 
 typedef struct Edge {
@@ -11,8 +14,49 @@ typedef struct Edge {
     int left;
     int top;
     int bottom;
+    int x;  //16.16 x at the center of the row being scanned
+    int dx; //16.16 change in x per row
 } Edge;
 
+static const float kFixedOne = 65536.0f;
+static const float kMaxFixed = 32767.0f;
+
+/**
+ *  GRoundToInt for values well inside of int's range, without the call to floorf (which is
+ *  not inlined unless the build enables SSE4.1). Truncation rounds negatives up, so they are
+ *  stepped back down.
+ */
+static int fastRoundToInt(float v) {
+    v += 0.5f;
+    int i = (int)v;
+    return i - (v < i);
+}
+
+static int floatToFixed(float v) {
+    v = std::max(-kMaxFixed, std::min(kMaxFixed, v));
+    return fastRoundToInt(v * kFixedOne);
+}
+
+//Same as GRoundToInt on the value the fixed point holds
+static int fixedRoundToInt(int x) {
+    return (x + (1 << 15)) >> 16;
+}
+
+//Point the edge's x at the center of row y
+static void seekEdge(Edge& e, int y) {
+    e.x = floatToFixed(e.m * (y + 0.5f) + e.b);
+}
+
+/**
+ *  Point the edge's x at the center of row y as if it had been stepped there from row anchor.
+ *  Clipping the top of an edge then leaves its x on the remaining rows as it was.
+ */
+static void seekEdge(Edge& e, int y, int anchor) {
+    const int64_t limit = (int64_t)kMaxFixed * (int)kFixedOne;
+    int64_t x = floatToFixed(e.m * (anchor + 0.5f) + e.b) + (int64_t)(y - anchor) * e.dx;
+    e.x = (int)std::max(-limit, std::min(limit, x));
+}
+
 static Edge createEdge(GPoint p1, GPoint p2, float w, float m, float b);
 static Edge createEdge(GPoint p1, GPoint p2, int w);
 
@@ -30,5 +74,9 @@ static Edge createEdge(GPoint p1, GPoint p2, float w, float m, float b) {
     e.left = GRoundToInt(std::min(p1.x(), p2.x()));
     e.top = GRoundToInt(std::min(p1.y(), p2.y()));
     e.bottom = GRoundToInt(std::max(p1.y(), p2.y()));
+    e.dx = floatToFixed(m);
+    seekEdge(e, e.top);
     return e;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZFill_DEFINED
+#define ZFill_DEFINED
+
+#include "GPixel.h"
+#include "ZSimd.h"
+
+#include <algorithm>
+
+/**
+ *  Fills at or above this many bytes bypass the cache with streaming stores. A fill this big
+ *  would evict everything else anyway, and nothing reads the pixels back right away.
+ */
+static const size_t kStreamingFillBytes = 1 << 21;
+
+static void fillRow(GPixel* dst, int count, GPixel value, bool streaming) {
+    int i = 0;
+#if defined(__SSE2__)
+    //Reach 16 byte alignment, then store whole vectors
+    for (; i < count && ((uintptr_t)(dst + i) & 15); i++) {
+        dst[i] = value;
+    }
+    const __m128i v = _mm_set1_epi32((int)value);
+    if (streaming) {
+        for (; i + 16 <= count; i += 16) {
+            _mm_stream_si128((__m128i*)(dst + i), v);
+            _mm_stream_si128((__m128i*)(dst + i + 4), v);
+            _mm_stream_si128((__m128i*)(dst + i + 8), v);
+            _mm_stream_si128((__m128i*)(dst + i + 12), v);
+        }
+        for (; i + 4 <= count; i += 4) {
+            _mm_stream_si128((__m128i*)(dst + i), v);
+        }
+    }
+    else {
+        for (; i + 16 <= count; i += 16) {
+            _mm_store_si128((__m128i*)(dst + i), v);
+            _mm_store_si128((__m128i*)(dst + i + 4), v);
+            _mm_store_si128((__m128i*)(dst + i + 8), v);
+            _mm_store_si128((__m128i*)(dst + i + 12), v);
+        }
+        for (; i + 4 <= count; i += 4) {
+            _mm_store_si128((__m128i*)(dst + i), v);
+        }
+    }
+#endif
+    std::fill(dst + i, dst + count, value);
+}
+
+//Fill a width x height block of pixels, rowPixels apart, with a constant pixel
+static void fillRect(GPixel* dst, size_t rowPixels, int width, int height, GPixel value) {
+    bool streaming = (size_t)width * height * sizeof(GPixel) >= kStreamingFillBytes;
+    if (rowPixels == (size_t)width) {
+        //Contiguous rows are one long row
+        while (height > 0) {
+            int rows = std::min(height, INT32_MAX / std::max(width, 1));
+            fillRow(dst, rows * width, value, streaming);
+            dst += (size_t)rows * width;
+            height -= rows;
+        }
+    }
+    else {
+        for (int y = 0; y < height; y++) {
+            fillRow(dst + y * rowPixels, width, value, streaming);
+        }
+    }
+#if defined(__SSE2__)
+    //Streaming stores are weakly ordered; publish them before anyone reads the pixels
+    if (streaming) _mm_sfence();
+#endif
+}
+
+#endif
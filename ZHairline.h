@@ -0,0 +1,168 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZHairline_DEFINED
+#define ZHairline_DEFINED
+
+#include "GPoint.h"
+#include "GRect.h"
+#include "ZBlitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ *  Hairlines are one pixel wide on the device. A line is walked along its major axis (the
+ *  one it moves furthest along), one pixel per column (or row), in 16.16 fixed point. A
+ *  segment owns the columns whose centers are between its ends, including its start but
+ *  not its end, so the segments of an aliased polyline meet without blending a pixel twice;
+ *  the last segment also owns its end. An anti-aliased step covers two pixels across the
+ *  line, so near a corner the segments can still both blend a pixel.
+ */
+
+//Pixels [first, last] along the major axis whose centers lie between from and to
+static bool hairlineSpan(float from, float to, bool includeEnd, int* first, int* last) {
+    if (to > from) {
+        *first = (int)std::ceil(from - 0.5f);
+        *last = includeEnd ? (int)std::floor(to - 0.5f) : (int)std::ceil(to - 0.5f) - 1;
+    } else {
+        *last = (int)std::floor(from - 0.5f);
+        *first = includeEnd ? (int)std::ceil(to - 0.5f) : (int)std::floor(to - 0.5f) + 1;
+    }
+    return *first <= *last;
+}
+
+/**
+ *  Walk the pixels of the segment from a to b that are inside clip, in that order, calling
+ *  plot(major, minorFixed) with the minor coordinate, at the center of the pixel along the
+ *  major axis, in 16.16.
+ */
+template <typename Plot>
+static void walkHairline(GPoint a, GPoint b, bool includeEnd, bool xMajor, const GIRect& clip, Plot plot) {
+    float a0 = xMajor ? a.x() : a.y();
+    float a1 = xMajor ? a.y() : a.x();
+    float b0 = xMajor ? b.x() : b.y();
+    float b1 = xMajor ? b.y() : b.x();
+    int first, last;
+    if (!hairlineSpan(a0, b0, includeEnd, &first, &last)) return;
+    //Pixels off of the clip along the major axis are never walked
+    first = std::max(first, xMajor ? clip.fLeft : clip.fTop);
+    last = std::min(last, (xMajor ? clip.fRight : clip.fBottom) - 1);
+    if (first > last) return;
+    //From a towards b. |slope| <= 1, so the walk stays within range of int64_t.
+    int direction = b0 > a0 ? 1 : -1;
+    int start = direction > 0 ? first : last;
+    float slope = (b1 - a1) / (b0 - a0);
+    int64_t minor = (int64_t)std::llround((a1 + slope * (start + 0.5f - a0)) * 65536.0);
+    int64_t step = (int64_t)std::llround(slope * direction * 65536.0);
+    for (int i = 0; i <= last - first; i++, minor += step) {
+        plot(start + i * direction, minor);
+    }
+}
+
+/**
+ *  Clip the segment from a to b to clip, grown by a pixel so that the pixels an anti-aliased
+ *  line spreads onto next to the clip are kept. An end outside is moved along the segment
+ *  onto the edge it is past, in double, so ends far off of the device keep the line where it
+ *  is; an end inside is left as it was. Returns false if nothing is left, or an end is not
+ *  finite.
+ */
+static bool clipHairline(GPoint* a, GPoint* b, const GIRect& clip) {
+    if (!std::isfinite(a->x()) || !std::isfinite(a->y()) || !std::isfinite(b->x()) || !std::isfinite(b->y())) return false;
+    double ends[2][2] = { { a->x(), a->y() }, { b->x(), b->y() } };
+    const double lo[2] = { clip.fLeft - 1.0, clip.fTop - 1.0 };
+    const double hi[2] = { clip.fRight + 1.0, clip.fBottom + 1.0 };
+    //Once x is within the clip, moving along the segment keeps it there, so each axis is clipped once
+    for (int axis = 0; axis < 2; axis++) {
+        for (int i = 0; i < 2; i++) {
+            double* p = ends[i];
+            const double* q = ends[1 - i];
+            double edge = p[axis] < lo[axis] ? lo[axis] : p[axis] > hi[axis] ? hi[axis] : p[axis];
+            if (edge == p[axis]) continue;
+            //Both past the same edge
+            if ((q[axis] < lo[axis] && edge == lo[axis]) || (q[axis] > hi[axis] && edge == hi[axis])) return false;
+            p[1 - axis] += (edge - p[axis]) * (q[1 - axis] - p[1 - axis]) / (q[axis] - p[axis]);
+            p[axis] = edge;
+        }
+    }
+    *a = GPoint::Make((float)ends[0][0], (float)ends[0][1]);
+    *b = GPoint::Make((float)ends[1][0], (float)ends[1][1]);
+    return true;
+}
+
+/**
+ *  An aliased hairline. Pixels of a row are merged into one span. last holds the pixel the
+ *  previous segment of the polyline ended on (or anything off of the device for the first
+ *  segment), which is skipped if this one starts on it too, and is set to this one's last.
+ */
+static void hairline(GPoint a, GPoint b, bool includeEnd, const GIRect& clip, ZBlitter* blitter, int last[2]) {
+    if (!clipHairline(&a, &b, clip) || a == b) return;
+    bool started = false;
+    auto skip = [&](int x, int y) {
+        bool repeat = !started && x == last[0] && y == last[1];
+        started = true;
+        last[0] = x;
+        last[1] = y;
+        return repeat;
+    };
+    if (std::abs(b.x() - a.x()) >= std::abs(b.y() - a.y())) {
+        int runX = 0, runY = 0, runLength = 0;
+        walkHairline(a, b, includeEnd, true, clip, [&](int x, int64_t minor) {
+            int y = (int)(minor >> 16);
+            if (y < clip.fTop || y >= clip.fBottom || skip(x, y)) return;
+            //Lines are walked in either direction, so a span can grow at either end
+            if (runLength > 0 && y == runY && (x == runX + runLength || x == runX - 1)) {
+                runX = std::min(runX, x);
+                runLength++;
+                return;
+            }
+            if (runLength > 0) blitter->blitH(runX, runY, runLength);
+            runX = x;
+            runY = y;
+            runLength = 1;
+        });
+        if (runLength > 0) blitter->blitH(runX, runY, runLength);
+        return;
+    }
+    walkHairline(a, b, includeEnd, false, clip, [&](int y, int64_t minor) {
+        int x = (int)(minor >> 16);
+        if (x >= clip.fLeft && x < clip.fRight && !skip(x, y)) blitter->blitH(x, y, 1);
+    });
+}
+
+/**
+ *  An anti-aliased (Wu) hairline. At each step along the major axis the line's coverage is
+ *  split between the two pixels whose centers it falls between, in proportion to how close
+ *  it is to each.
+ */
+static void antiHairline(GPoint a, GPoint b, bool includeEnd, const GIRect& clip, ZBlitter* blitter) {
+    if (!clipHairline(&a, &b, clip) || a == b) return;
+    bool xMajor = std::abs(b.x() - a.x()) >= std::abs(b.y() - a.y());
+    walkHairline(a, b, includeEnd, xMajor, clip, [&](int major, int64_t minor) {
+        //The line is between the centers of pixel lower and the next, at this fraction
+        int64_t centered = minor - (1 << 15);
+        int lower = (int)(centered >> 16);
+        unsigned upperAlpha = (unsigned)((centered & 0xFFFF) >> 8);
+        uint8_t alpha[2] = { (uint8_t)(255 - upperAlpha), (uint8_t)upperAlpha };
+        int lo = xMajor ? clip.fTop : clip.fLeft;
+        int hi = xMajor ? clip.fBottom : clip.fRight;
+        if (xMajor) {
+            const int16_t runs[2] = { 1, 0 };
+            for (int i = 0; i < 2; i++) {
+                if (alpha[i] > 0 && lower + i >= lo && lower + i < hi) blitter->blitAntiH(major, lower + i, &alpha[i], runs);
+            }
+            return;
+        }
+        //Both pixels are on one row
+        int start = std::max(lower, lo);
+        int end = std::min(lower + 2, hi);
+        if (start >= end) return;
+        int16_t runs[3] = { 1, 1, 0 };
+        if (end - start == 1) runs[1] = 0;
+        blitter->blitAntiH(start, major, alpha + (start - lower), runs);
+    });
+}
+
+#endif
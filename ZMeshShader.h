@@ -0,0 +1,161 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZMeshShader_DEFINED
+#define ZMeshShader_DEFINED
+
+#include "GColor.h"
+#include "GMath.h"
+#include "GMatrix.h"
+#include "GPixel.h"
+#include "GPoint.h"
+#include "GShader.h"
+#include "ZEdge.h"
+#include "ZSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ *  Shades the triangles of drawMesh. One shader is reused for every triangle of a mesh, and
+ *  setTriangle, given the triangle already in device space, turns its colors into 16.16 fixed
+ *  point gradients of 0...255. A span then costs one add per channel per pixel, with no matrix
+ *  mapping and nothing allocated, and a pixel's color is exactly the same whichever span it is
+ *  shaded in, even when a clip splits the row.
+ *
+ *  Texture coordinates map the paint's shader onto the triangle, so that shader is given a
+ *  context that takes device space straight to texture space and shades the span itself.
+ */
+class ZMeshShader : public GShader {
+
+public:
+
+    ZMeshShader() : fTexShader(nullptr), fHasColors(false), fOpaque(false) {}
+
+    /**
+     *  colors and texs may each be null, but not both, and texs need the paint's shader.
+     *  Returns false if the triangle has no area (or its texture coordinates none), in which
+     *  case there is nothing to draw.
+     */
+    bool setTriangle(const GPoint pts[3], const GColor colors[3], const GPoint texs[3], GShader* texShader) {
+        //(u, v) = inv * (x - x0, y - y0) takes the corners to (0, 0), (1, 0) and (0, 1)
+        float e1x = pts[1].x() - pts[0].x();
+        float e1y = pts[1].y() - pts[0].y();
+        float e2x = pts[2].x() - pts[0].x();
+        float e2y = pts[2].y() - pts[0].y();
+        float det = e1x * e2y - e1y * e2x;
+        if (det == 0 || !std::isfinite(det)) return false;
+        float scale = 1 / det;
+        float inv[4] = { e2y * scale, -e2x * scale, -e1y * scale, e1x * scale };
+        fHasColors = colors != nullptr;
+        fTexShader = texs ? texShader : nullptr;
+        fOpaque = true;
+        if (fHasColors) {
+            //color = c0 + u * (c1 - c0) + v * (c2 - c0), measured from the center of the pixel
+            //at the first corner to keep the floats small. Like a color, the result is pinned
+            //to [0, 1] per pixel.
+            //Any corner of a triangle that reaches the device is well inside of this
+            const float limit = 1 << 24;
+            fAnchorX = fastRoundToInt(std::max(-limit, std::min(limit, pts[0].x())));
+            fAnchorY = fastRoundToInt(std::max(-limit, std::min(limit, pts[0].y())));
+            float dx = fAnchorX + 0.5f - pts[0].x();
+            float dy = fAnchorY + 0.5f - pts[0].y();
+            float u = inv[0] * dx + inv[1] * dy;
+            float v = inv[2] * dx + inv[3] * dy;
+            const GColor* c = colors;
+            fOpaque = c[0].a >= 1 && c[1].a >= 1 && c[2].a >= 1;
+            const float c0[4] = { c[0].a, c[0].r, c[0].g, c[0].b };
+            const float d1[4] = { c[1].a - c[0].a, c[1].r - c[0].r, c[1].g - c[0].g, c[1].b - c[0].b };
+            const float d2[4] = { c[2].a - c[0].a, c[2].r - c[0].r, c[2].g - c[0].g, c[2].b - c[0].b };
+            for (int i = 0; i < 4; i++) {
+                fDx[i] = toFixed(inv[0] * d1[i] + inv[2] * d2[i]);
+                fDy[i] = toFixed(inv[1] * d1[i] + inv[3] * d2[i]);
+                fOrigin[i] = toFixed(c0[i] + u * d1[i] + v * d2[i]);
+            }
+        }
+        if (fTexShader) {
+            GMatrix texToUnit;
+            if (!triangleMatrix(texs).invert(&texToUnit)) return false;
+            GMatrix unitToDevice(e1x, e2x, pts[0].x(), e1y, e2y, pts[0].y());
+            if (!fTexShader->setContext(GMatrix::Concat(unitToDevice, texToUnit))) return false;
+            fOpaque &= fTexShader->isOpaque();
+        }
+        return true;
+    }
+
+    bool isOpaque() override {
+        return fOpaque;
+    }
+
+    //The triangle is already in device space
+    bool setContext(const GMatrix& ctm) override {
+        return true;
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        if (!fHasColors) {
+            fTexShader->shadeRow(x, y, count, row);
+            return;
+        }
+        int64_t c[4];
+        for (int i = 0; i < 4; i++) {
+            c[i] = fOrigin[i] + fDy[i] * (y - fAnchorY) + fDx[i] * (x - fAnchorX);
+        }
+        if (fTexShader) fTexShader->shadeRow(x, y, count, row);
+        for (int i = 0; i < count; i++) {
+            GPixel color = fixedToPixel(c);
+            row[i] = fTexShader ? modulate(color, row[i]) : color;
+            c[0] += fDx[0];
+            c[1] += fDx[1];
+            c[2] += fDx[2];
+            c[3] += fDx[3];
+        }
+    }
+
+private:
+
+    static GMatrix triangleMatrix(const GPoint pts[3]) {
+        return GMatrix(pts[1].x() - pts[0].x(), pts[2].x() - pts[0].x(), pts[0].x(),
+                       pts[1].y() - pts[0].y(), pts[2].y() - pts[0].y(), pts[0].y());
+    }
+
+    //A channel value of 0...1 to 16.16 fixed point of 0...255. Thin triangles can have huge
+    //gradients, so the value is kept in range of int64_t. Rounds like fastRoundToInt, as signs
+    //are random enough that a branch on them mispredicts.
+    static int64_t toFixed(float v) {
+        v = std::max(-1e9f, std::min(1e9f, v)) * (255 * 65536.0f) + 0.5f;
+        int64_t i = (int64_t)v;
+        return i - (v < i);
+    }
+
+    //Steps can leave [0, 255] outside of the triangle's corners, so they are pinned
+    static unsigned fixedToByte(int64_t v) {
+        return (unsigned)std::max<int64_t>(0, std::min<int64_t>(255, (v + (1 << 15)) >> 16));
+    }
+
+    static GPixel fixedToPixel(const int64_t c[4]) {
+        unsigned a = fixedToByte(c[0]);
+        return GPixel_PackARGB(a, div255(a * fixedToByte(c[1])), div255(a * fixedToByte(c[2])), div255(a * fixedToByte(c[3])));
+    }
+
+    static GPixel modulate(GPixel a, GPixel b) {
+        return GPixel_PackARGB(div255(GPixel_GetA(a) * GPixel_GetA(b)), div255(GPixel_GetR(a) * GPixel_GetR(b)),
+                               div255(GPixel_GetG(a) * GPixel_GetG(b)), div255(GPixel_GetB(a) * GPixel_GetB(b)));
+    }
+
+    GShader* fTexShader;
+    bool fHasColors;
+    bool fOpaque;
+
+    //Each channel (a, r, g, b) is fOrigin + fDx * dx + fDy * dy at dx, dy pixels from the anchor
+    int fAnchorX;
+    int fAnchorY;
+    int64_t fOrigin[4];
+    int64_t fDx[4];
+    int64_t fDy[4];
+
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZMipmap_DEFINED
+#define ZMipmap_DEFINED
+
+#include "GBitmap.h"
+#include "ZSimd.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ *  Average each 2x2 block of src into one pixel of dst, which is half of src's size (rounded
+ *  down, but at least 1). A source with an odd size repeats its last row or column. Every
+ *  channel is (a + b + c + d + 2) >> 2 however many pixels are done at once, and averaging
+ *  premultiplied pixels keeps them premultiplied.
+ */
+static void downsample(const GBitmap& src, const GBitmap& dst) {
+    for (int y = 0; y < dst.height(); y++) {
+        const GPixel* row0 = src.getAddr(0, std::min(2 * y, src.height() - 1));
+        const GPixel* row1 = src.getAddr(0, std::min(2 * y + 1, src.height() - 1));
+        GPixel* out = dst.getAddr(0, y);
+        int x = 0;
+#if defined(__SSE2__)
+        //Four pixels from eight, while the source has all eight
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 4 <= dst.width() && 2 * x + 8 <= src.width(); x += 4) {
+            __m128 a0 = _mm_castsi128_ps(ZVec4::Load(row0 + 2 * x));
+            __m128 b0 = _mm_castsi128_ps(ZVec4::Load(row0 + 2 * x + 4));
+            __m128 a1 = _mm_castsi128_ps(ZVec4::Load(row1 + 2 * x));
+            __m128 b1 = _mm_castsi128_ps(ZVec4::Load(row1 + 2 * x + 4));
+            __m128i even0 = _mm_castps_si128(_mm_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i odd0 = _mm_castps_si128(_mm_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i even1 = _mm_castps_si128(_mm_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i odd1 = _mm_castps_si128(_mm_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(even0, zero), _mm_unpacklo_epi8(odd0, zero)),
+                                       _mm_add_epi16(_mm_unpacklo_epi8(even1, zero), _mm_unpacklo_epi8(odd1, zero)));
+            __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(even0, zero), _mm_unpackhi_epi8(odd0, zero)),
+                                       _mm_add_epi16(_mm_unpackhi_epi8(even1, zero), _mm_unpackhi_epi8(odd1, zero)));
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+            ZVec4::Store(out + x, _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; x < dst.width(); x++) {
+            int x0 = std::min(2 * x, src.width() - 1);
+            int x1 = std::min(2 * x + 1, src.width() - 1);
+            const GPixel p[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+            //Two channels at a time, each with room for the sum of four
+            const uint32_t mask = 0x00FF00FF;
+            uint32_t rb = 0x00020002, ag = 0x00020002;
+            for (GPixel c : p) {
+                rb += c & mask;
+                ag += (c >> 8) & mask;
+            }
+            out[x] = ((rb >> 2) & mask) | ((ag << 6) & ~mask);
+        }
+    }
+}
+
+/**
+ *  The mip pyramid of a bitmap: level 0 is a copy of the bitmap, and each level after it is
+ *  the one before downsampled by 2 in each direction, down to 1x1. Every level is built at
+ *  once from the bitmap's pixels as they are then, so later changes to them are not seen.
+ */
+class ZMipmap {
+
+public:
+
+    void build(const GBitmap& bitmap) {
+        fLevels.clear();
+        fStorage.clear();
+        //Level 0 is copied row by row, as the bitmap's rows can be padded
+        int w = bitmap.width(), h = bitmap.height();
+        fStorage.emplace_back((size_t)w * h);
+        for (int y = 0; y < h; y++) {
+            std::copy(bitmap.getAddr(0, y), bitmap.getAddr(0, y) + w, fStorage.back().data() + (size_t)y * w);
+        }
+        fLevels.push_back(GBitmap(w, h, w * sizeof(GPixel), fStorage.back().data(), bitmap.isOpaque()));
+        while (w > 1 || h > 1) {
+            const GBitmap& src = fLevels.back();
+            w = std::max(1, w >> 1);
+            h = std::max(1, h >> 1);
+            fStorage.emplace_back((size_t)w * h);
+            GBitmap dst(w, h, w * sizeof(GPixel), fStorage.back().data(), false);
+            downsample(src, dst);
+            //Averages of opaque pixels are opaque
+            if (src.isOpaque()) dst.setIsOpaque(GBitmap::kYes_IsOpaque);
+            fLevels.push_back(dst);
+        }
+    }
+
+    int levelCount() const {
+        return (int)fLevels.size();
+    }
+
+    //Level (clamped to the smallest)
+    const GBitmap& level(int index) const {
+        return fLevels[std::min(index, levelCount() - 1)];
+    }
+
+private:
+
+    std::vector<GBitmap> fLevels;
+    std::vector<std::vector<GPixel>> fStorage;
+
+};
+
+#endif
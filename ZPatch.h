@@ -0,0 +1,101 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZPatch_DEFINED
+#define ZPatch_DEFINED
+
+#include "GPoint.h"
+
+#include <vector>
+
+/**
+ *  Evaluate a cubic at n + 1 evenly spaced t (0, 1/n, ..., 1) by forward differencing: after
+ *  the setup, each point costs three adds per coordinate. The last point is the cubic's end
+ *  point exactly, so neighboring curves that share it still meet.
+ */
+static void forwardDifferenceCubic(const GPoint pts[4], int n, GPoint out[]) {
+    //P(t) = a t^3 + b t^2 + c t + d
+    float h = 1.0f / n;
+    float ax = pts[3].x() - 3 * pts[2].x() + 3 * pts[1].x() - pts[0].x();
+    float ay = pts[3].y() - 3 * pts[2].y() + 3 * pts[1].y() - pts[0].y();
+    float bx = 3 * (pts[2].x() - 2 * pts[1].x() + pts[0].x());
+    float by = 3 * (pts[2].y() - 2 * pts[1].y() + pts[0].y());
+    float cx = 3 * (pts[1].x() - pts[0].x());
+    float cy = 3 * (pts[1].y() - pts[0].y());
+    float x = pts[0].x(), y = pts[0].y();
+    float dx1 = ((ax * h + bx) * h + cx) * h;
+    float dy1 = ((ay * h + by) * h + cy) * h;
+    float dx3 = 6 * ax * h * h * h;
+    float dy3 = 6 * ay * h * h * h;
+    float dx2 = dx3 + 2 * bx * h * h;
+    float dy2 = dy3 + 2 * by * h * h;
+    for (int i = 0; i < n; i++) {
+        out[i] = { x, y };
+        x += dx1;
+        y += dy1;
+        dx1 += dx2;
+        dy1 += dy2;
+        dx2 += dx3;
+        dy2 += dy3;
+    }
+    out[n] = pts[3];
+}
+
+//Boundary curves of a patch, kept between patches so evaluating one does not allocate
+struct ZPatchBuffers {
+    std::vector<GPoint> top;
+    std::vector<GPoint> bottom;
+    std::vector<GPoint> left;
+    std::vector<GPoint> right;
+};
+
+/**
+ *  Evaluate the Coons patch bounded by cubics (clockwise from the top-left corner, as in
+ *  GCanvas::drawPatch) on an (n + 1) x (n + 1) grid, row by row from the top, into out.
+ *
+ *  With u across and v down, the patch is the sum of the lofts between the top and bottom
+ *  curves and between the left and right curves, less the bilinear patch of the corners:
+ *      S = top(u) + v (bottom(u) - top(u)) + left(v) + u (right(v) - left(v)) - B(u, v)
+ *  The four curves are forward differenced once each; every grid point is then a few
+ *  multiplies and adds.
+ */
+static void evalCoonsPatch(const GPoint cubics[12], int n, ZPatchBuffers& buffers, GPoint out[]) {
+    buffers.top.resize(n + 1);
+    buffers.bottom.resize(n + 1);
+    buffers.left.resize(n + 1);
+    buffers.right.resize(n + 1);
+    const GPoint top[4] = { cubics[0], cubics[1], cubics[2], cubics[3] };
+    const GPoint right[4] = { cubics[3], cubics[4], cubics[5], cubics[6] };
+    const GPoint bottom[4] = { cubics[9], cubics[8], cubics[7], cubics[6] };
+    const GPoint left[4] = { cubics[0], cubics[11], cubics[10], cubics[9] };
+    forwardDifferenceCubic(top, n, buffers.top.data());
+    forwardDifferenceCubic(bottom, n, buffers.bottom.data());
+    forwardDifferenceCubic(left, n, buffers.left.data());
+    forwardDifferenceCubic(right, n, buffers.right.data());
+
+    //bottom - top, reused by every row
+    for (int j = 0; j <= n; j++) {
+        buffers.bottom[j] = GPoint(buffers.bottom[j] - buffers.top[j]);
+    }
+    const GPoint& c0 = cubics[0];
+    const GPoint& c1 = cubics[3];
+    const GPoint& c2 = cubics[6];
+    const GPoint& c3 = cubics[9];
+    float h = 1.0f / n;
+    for (int i = 0; i <= n; i++) {
+        float v = i * h;
+        //The bilinear patch along this row is bl + u (br - bl)
+        GPoint bl = c0 * (1 - v) + c3 * v;
+        GPoint br = c1 * (1 - v) + c2 * v;
+        GPoint base = GPoint(buffers.left[i] - bl);
+        GPoint slope = GPoint((buffers.right[i] - buffers.left[i]) - (br - bl));
+        GPoint* row = out + i * (n + 1);
+        for (int j = 0; j <= n; j++) {
+            float u = j * h;
+            row[j] = buffers.top[j] + buffers.bottom[j] * v + base + slope * u;
+        }
+    }
+}
+
+#endif
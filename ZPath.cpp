@@ -60,10 +60,11 @@ GPath& GPath::addCircle(GPoint center, float radius, Direction dir) {
 }
 
 GRect GPath::bounds() const {
-    float xMin = FLT_MAX;
-    float yMin = FLT_MAX;
-    float xMax = FLT_MIN;
-    float yMax = FLT_MIN;
+    if (fPts.empty()) return GRect::LTRB(0, 0, 0, 0);
+    float xMin = fPts[0].fX;
+    float yMin = fPts[0].fY;
+    float xMax = fPts[0].fX;
+    float yMax = fPts[0].fY;
     for (GPoint p: fPts) {
         if (p.fX < xMin) xMin = p.fX;
         if (p.fX > xMax) xMax = p.fX;
@@ -73,17 +74,9 @@ GRect GPath::bounds() const {
     return GRect::LTRB(xMin, yMin, xMax, yMax);
 }
 
+//mapPoints reads each point before writing it, so the points are mapped in place
 void GPath::transform(const GMatrix& m) {
-    int n = fPts.size();
-    GPoint pts[n];
-    GPoint transformed[n];
-    for (int i = 0; i < n; i++) {
-        pts[i] = fPts[i];
-    }
-    m.mapPoints(transformed, pts, n);
-    for (int i = 0; i < n; i++) {
-        fPts[i] = transformed[i];
-    }
+    m.mapPoints(fPts.data(), fPts.data(), fPts.size());
 }
 
 GPoint interpolate(GPoint p0, GPoint p1, float t) {
@@ -2,6 +2,30 @@
  * Copyright 2022 Zack Schrage
  */
 
+#ifndef ZPath_DEFINED
+#define ZPath_DEFINED
+
+#include "GMatrix.h"
 #include "GPoint.h"
 
-typedef void (ChopperFunction) (const GPoint[], GPoint[], float);
\ No newline at end of file
+#include <algorithm>
+
+typedef void (ChopperFunction) (const GPoint[], GPoint[], float);
+
+/**
+ *  Map one segment of a path (at most 4 points) into device space in place, and return
+ *  whether it can reach the rows [top, bottom). A segment is inside the hull of its points,
+ *  so one that misses the rows adds nothing and is dropped before it is flattened.
+ */
+static bool mapSegment(const GMatrix& matrix, GPoint pts[], int count, float top, float bottom) {
+    matrix.mapPoints(pts, count);
+    float yMin = pts[0].y();
+    float yMax = pts[0].y();
+    for (int i = 1; i < count; i++) {
+        yMin = std::min(yMin, pts[i].y());
+        yMax = std::max(yMax, pts[i].y());
+    }
+    return yMax > top && yMin < bottom;
+}
+
+#endif
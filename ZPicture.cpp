@@ -0,0 +1,383 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#include "GPicture.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GPath.h"
+#include "GPoint.h"
+#include "GRect.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ *  A display list. Each call is a small fixed size record, and its arguments are copied into
+ *  typed pools that the record points into by index, so a picture of thousands of calls is a
+ *  handful of allocations. Paths are flattened into the pools too, as their points and verbs,
+ *  and built again into the picture's scratch path as they are played back. Consecutive calls
+ *  with an equal paint share one paint entry.
+ */
+class ZPicture : public GPicture {
+
+public:
+
+    enum Op : uint8_t {
+        kSave,
+        kRestore,
+        kConcat,
+        kClipRect,
+        kClipPath,
+        kDrawPaint,
+        kDrawRect,
+        kDrawConvexPolygon,
+        kDrawPath,
+        kDrawMesh,
+        kDrawQuad,
+        kDrawPatch,
+        kDrawStroke,
+    };
+
+    //Optional per vertex arrays of drawMesh, drawQuad and drawPatch
+    enum Flags : uint8_t {
+        kHasColors = 1 << 0,
+        kHasTexs = 1 << 1,
+    };
+
+    /**
+     *  data and extra index the pools, depending on the op:
+     *      kConcat             data: fMatrices
+     *      kClipRect           data: fRects
+     *      kClipPath           data: fPoints, extra: fVerbs (count verbs)
+     *      kDrawRect           data: fRects
+     *      kDrawConvexPolygon  data: fPoints (count points)
+     *      kDrawPath           data: fPoints, extra: fVerbs (count verbs)
+     *      kDrawMesh           data: fPoints (verts, then texs), extra: fInts (vertex count,
+     *                          colors offset, then 3 * count indices)
+     *      kDrawQuad           data: fPoints (4 verts, then 4 texs), extra: fColors, count: level
+     *      kDrawPatch          data: fPoints (12 cubics, then 4 texs), extra: fColors, count: level
+     *      kDrawStroke         data: fPoints (count points), extra: bend type, flags: cap type,
+     *                          value: thickness
+     */
+    struct Record {
+        Op op;
+        uint8_t flags;
+        int paint;
+        int data;
+        int extra;
+        int count;
+        float value;
+    };
+
+    void playback(GCanvas* canvas) const override {
+        canvas->save();
+        for (const Record& r : fRecords) {
+            //Only draws have a paint
+            const GPaint& paint = r.paint >= 0 ? fPaints[r.paint] : fDefaultPaint;
+            switch (r.op) {
+                case kSave:
+                    canvas->save();
+                    break;
+                case kRestore:
+                    canvas->restore();
+                    break;
+                case kConcat:
+                    canvas->concat(fMatrices[r.data]);
+                    break;
+                case kClipRect:
+                    canvas->clipRect(fRects[r.data]);
+                    break;
+                case kClipPath:
+                    canvas->clipPath(loadPath(r));
+                    break;
+                case kDrawPaint:
+                    canvas->drawPaint(paint);
+                    break;
+                case kDrawRect:
+                    canvas->drawRect(fRects[r.data], paint);
+                    break;
+                case kDrawConvexPolygon:
+                    canvas->drawConvexPolygon(fPoints.data() + r.data, r.count, paint);
+                    break;
+                case kDrawPath:
+                    canvas->drawPath(loadPath(r), paint);
+                    break;
+                case kDrawMesh: {
+                    const int* header = fInts.data() + r.extra;
+                    const GPoint* verts = fPoints.data() + r.data;
+                    const GColor* colors = r.flags & kHasColors ? fColors.data() + header[1] : nullptr;
+                    const GPoint* texs = r.flags & kHasTexs ? verts + header[0] : nullptr;
+                    canvas->drawMesh(verts, colors, texs, r.count, header + 2, paint);
+                    break;
+                }
+                case kDrawQuad: {
+                    const GPoint* verts = fPoints.data() + r.data;
+                    const GColor* colors = r.flags & kHasColors ? fColors.data() + r.extra : nullptr;
+                    const GPoint* texs = r.flags & kHasTexs ? verts + 4 : nullptr;
+                    canvas->drawQuad(verts, colors, texs, r.count, paint);
+                    break;
+                }
+                case kDrawPatch: {
+                    const GPoint* cubics = fPoints.data() + r.data;
+                    const GColor* colors = r.flags & kHasColors ? fColors.data() + r.extra : nullptr;
+                    const GPoint* texs = r.flags & kHasTexs ? cubics + 12 : nullptr;
+                    canvas->drawPatch(cubics, colors, texs, r.count, paint);
+                    break;
+                }
+                case kDrawStroke:
+                    canvas->drawStroke(fPoints.data() + r.data, r.count, r.value, (GCanvas::CapType)r.flags,
+                                       (GCanvas::BendType)r.extra, paint);
+                    break;
+            }
+        }
+        canvas->restore();
+    }
+
+    int count() const override { return (int)fRecords.size(); }
+
+    //Calls without arguments other than the paint
+    void add(Op op, int paint = -1) {
+        fRecords.push_back({ op, 0, paint, 0, 0, 0, 0 });
+    }
+
+    void add(Op op, int paint, int data, int count) {
+        fRecords.push_back({ op, 0, paint, data, 0, count, 0 });
+    }
+
+    void add(const Record& record) {
+        fRecords.push_back(record);
+    }
+
+    int addPaint(const GPaint& paint) {
+        if (fPaints.empty() || !samePaint(fPaints.back(), paint)) {
+            fPaints.push_back(paint);
+        }
+        return (int)fPaints.size() - 1;
+    }
+
+    int addMatrix(const GMatrix& matrix) {
+        fMatrices.push_back(matrix);
+        return (int)fMatrices.size() - 1;
+    }
+
+    int addRect(const GRect& rect) {
+        fRects.push_back(rect);
+        return (int)fRects.size() - 1;
+    }
+
+    //Sets the record's data, extra and count to the path's points and verbs
+    void addPath(const GPath& path, Record* r) {
+        r->data = (int)fPoints.size();
+        r->extra = (int)fVerbs.size();
+        GPath::Iter iter(path);
+        GPoint pts[GPath::kMaxNextPoints];
+        GPath::Verb verb;
+        while ((verb = iter.next(pts)) != GPath::kDone) {
+            fVerbs.push_back((uint8_t)verb);
+            if (verb == GPath::kMove) {
+                fPoints.push_back(pts[0]);
+            } else {
+                //Lines, quads and cubics add 1, 2 and 3 points after the one they start from
+                int count = verb == GPath::kLine ? 1 : (verb == GPath::kQuad ? 2 : 3);
+                fPoints.insert(fPoints.end(), pts + 1, pts + 1 + count);
+            }
+        }
+        r->count = (int)fVerbs.size() - r->extra;
+    }
+
+    int addPoints(const GPoint points[], int count) {
+        int offset = (int)fPoints.size();
+        fPoints.insert(fPoints.end(), points, points + count);
+        return offset;
+    }
+
+    int addColors(const GColor colors[], int count) {
+        int offset = (int)fColors.size();
+        fColors.insert(fColors.end(), colors, colors + count);
+        return offset;
+    }
+
+    int addInts(const int ints[], int count) {
+        int offset = (int)fInts.size();
+        fInts.insert(fInts.end(), ints, ints + count);
+        return offset;
+    }
+
+private:
+
+    //The path of a kDrawPath or kClipPath, built again in fScratch
+    const GPath& loadPath(const Record& r) const {
+        fScratch.reset();
+        const GPoint* pts = fPoints.data() + r.data;
+        const uint8_t* verbs = fVerbs.data() + r.extra;
+        for (int i = 0; i < r.count; i++) {
+            switch (verbs[i]) {
+                case GPath::kMove:
+                    fScratch.moveTo(pts[0]);
+                    pts += 1;
+                    break;
+                case GPath::kLine:
+                    fScratch.lineTo(pts[0]);
+                    pts += 1;
+                    break;
+                case GPath::kQuad:
+                    fScratch.quadTo(pts[0], pts[1]);
+                    pts += 2;
+                    break;
+                case GPath::kCubic:
+                    fScratch.cubicTo(pts[0], pts[1], pts[2]);
+                    pts += 3;
+                    break;
+            }
+        }
+        return fScratch;
+    }
+
+    static bool samePaint(const GPaint& a, const GPaint& b) {
+        return a.getColor() == b.getColor() && a.getShader() == b.getShader() &&
+               a.getBlendMode() == b.getBlendMode() && a.isAntiAlias() == b.isAntiAlias();
+    }
+
+    std::vector<Record> fRecords;
+    GPaint fDefaultPaint;
+    std::vector<GPaint> fPaints;
+    std::vector<GMatrix> fMatrices;
+    std::vector<GRect> fRects;
+    std::vector<GPoint> fPoints;
+    std::vector<uint8_t> fVerbs;
+    std::vector<GColor> fColors;
+    std::vector<int> fInts;
+    //Playback reuses it for every path, so it only allocates until it has grown
+    mutable GPath fScratch;
+
+};
+
+class ZRecordingCanvas : public GRecordingCanvas {
+
+public:
+
+    ZRecordingCanvas() : fPicture(new ZPicture), fSaveCount(0) {}
+
+    void save() override {
+        fSaveCount++;
+        fPicture->add(ZPicture::kSave);
+    }
+
+    //An unbalanced restore is an error, so it is dropped rather than replayed
+    void restore() override {
+        if (fSaveCount == 0) return;
+        fSaveCount--;
+        fPicture->add(ZPicture::kRestore);
+    }
+
+    void concat(const GMatrix& matrix) override {
+        fPicture->add(ZPicture::kConcat, -1, fPicture->addMatrix(matrix), 0);
+    }
+
+    void clipRect(const GRect& rect) override {
+        fPicture->add(ZPicture::kClipRect, -1, fPicture->addRect(rect), 0);
+    }
+
+    void clipPath(const GPath& path) override {
+        ZPicture::Record r = { ZPicture::kClipPath, 0, -1, 0, 0, 0, 0 };
+        fPicture->addPath(path, &r);
+        fPicture->add(r);
+    }
+
+    void drawPaint(const GPaint& paint) override {
+        fPicture->add(ZPicture::kDrawPaint, fPicture->addPaint(paint));
+    }
+
+    void drawRect(const GRect& rect, const GPaint& paint) override {
+        fPicture->add(ZPicture::kDrawRect, fPicture->addPaint(paint), fPicture->addRect(rect), 0);
+    }
+
+    void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
+        fPicture->add(ZPicture::kDrawConvexPolygon, fPicture->addPaint(paint), fPicture->addPoints(points, count), count);
+    }
+
+    void drawPath(const GPath& path, const GPaint& paint) override {
+        ZPicture::Record r = { ZPicture::kDrawPath, 0, fPicture->addPaint(paint), 0, 0, 0, 0 };
+        fPicture->addPath(path, &r);
+        fPicture->add(r);
+    }
+
+    //Only the vertices the indices reach are copied
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint& paint) override {
+        if (count <= 0) return;
+        int vertexCount = 0;
+        for (int i = 0; i < count * 3; i++) {
+            vertexCount = std::max(vertexCount, indices[i] + 1);
+        }
+        ZPicture::Record r = { ZPicture::kDrawMesh, 0, fPicture->addPaint(paint), 0, 0, count, 0 };
+        r.data = fPicture->addPoints(verts, vertexCount);
+        if (texs) {
+            fPicture->addPoints(texs, vertexCount);
+            r.flags |= ZPicture::kHasTexs;
+        }
+        int header[2] = { vertexCount, 0 };
+        if (colors) {
+            header[1] = fPicture->addColors(colors, vertexCount);
+            r.flags |= ZPicture::kHasColors;
+        }
+        r.extra = fPicture->addInts(header, 2);
+        fPicture->addInts(indices, count * 3);
+        fPicture->add(r);
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) override {
+        ZPicture::Record r = { ZPicture::kDrawQuad, 0, fPicture->addPaint(paint), 0, 0, level, 0 };
+        r.data = fPicture->addPoints(verts, 4);
+        if (texs) {
+            fPicture->addPoints(texs, 4);
+            r.flags |= ZPicture::kHasTexs;
+        }
+        if (colors) {
+            r.extra = fPicture->addColors(colors, 4);
+            r.flags |= ZPicture::kHasColors;
+        }
+        fPicture->add(r);
+    }
+
+    void drawPatch(const GPoint cubics[12], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) override {
+        ZPicture::Record r = { ZPicture::kDrawPatch, 0, fPicture->addPaint(paint), 0, 0, level, 0 };
+        r.data = fPicture->addPoints(cubics, 12);
+        if (texs) {
+            fPicture->addPoints(texs, 4);
+            r.flags |= ZPicture::kHasTexs;
+        }
+        if (colors) {
+            r.extra = fPicture->addColors(colors, 4);
+            r.flags |= ZPicture::kHasColors;
+        }
+        fPicture->add(r);
+    }
+
+    void drawStroke(const GPoint points[], int count, float thickness, CapType capType, BendType bendType, const GPaint& paint) override {
+        if (count <= 0) return;
+        ZPicture::Record r = { ZPicture::kDrawStroke, (uint8_t)capType, fPicture->addPaint(paint), 0, (int)bendType, count, thickness };
+        r.data = fPicture->addPoints(points, count);
+        fPicture->add(r);
+    }
+
+    //Saves left open are closed so the picture restores exactly what it saves
+    std::unique_ptr<GPicture> finishRecording() override {
+        for (; fSaveCount > 0; fSaveCount--) {
+            fPicture->add(ZPicture::kRestore);
+        }
+        std::unique_ptr<GPicture> picture(fPicture.release());
+        fPicture.reset(new ZPicture);
+        return picture;
+    }
+
+private:
+
+    std::unique_ptr<ZPicture> fPicture;
+    int fSaveCount;
+
+};
+
+std::unique_ptr<GRecordingCanvas> GCreateRecordingCanvas() {
+    return std::unique_ptr<GRecordingCanvas>(new ZRecordingCanvas);
+}
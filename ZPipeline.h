@@ -0,0 +1,134 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZPipeline_DEFINED
+#define ZPipeline_DEFINED
+
+#include "GBitmap.h"
+#include "GBlendMode.h"
+#include "GMatrix.h"
+#include "GPaint.h"
+#include "GShader.h"
+#include "ZBlendMode.h"
+#include "ZSimd.h"
+
+#include <cassert>
+
+static GPixel colorToPixel(const GColor& color) {
+    return GPixel_PackARGB(GRoundToInt(255 * color.a), GRoundToInt(255 * color.a * color.r), GRoundToInt(255 * color.a * color.g), GRoundToInt(255 * color.a * color.b));
+}
+
+/**
+ *  A raster pipeline built once per draw from the paint and the device. Spans are pushed
+ *  through the stages in chunks of kChunkSize pixels, so a shaded chunk is produced and
+ *  consumed while it is still in L1 instead of going through a whole-row buffer.
+ *
+ *  Stages run in order on the same chunk: the first one produces source pixels, the
+ *  following ones may filter them, and the last one blends them into the device.
+ */
+class ZPipeline {
+
+public:
+
+    enum {
+        kChunkSize = 64,
+        kMaxStages = 4,
+    };
+
+    typedef void (*Stage)(const ZPipeline& p, int x, int y, int count, GPixel chunk[], GPixel* dst);
+
+    ZPipeline(const GBitmap& device, const GPaint& paint) : fDevice(device), fShader(paint.getShader()), fMode(paint.getBlendMode()), fStageCount(0) {
+        fColor = colorToPixel(paint.getColor());
+        int alpha = GPixel_GetA(fColor);
+        if (fShader != nullptr) {
+            //The shader's pixels are the source, so only whether they are opaque is known
+            alpha = fShader->isOpaque() ? 255 : 1;
+            append(&shadeStage);
+        }
+        fBlend = pickBlend(fMode, alpha, fShader != nullptr);
+        append(&blendStage);
+    }
+
+    //Must be called with the CTM before the first blitRow. Returns false if nothing can be drawn.
+    bool setContext(const GMatrix& ctm) const {
+        return fShader == nullptr || fShader->setContext(ctm);
+    }
+
+    void append(Stage stage) {
+        assert(fStageCount < kMaxStages);
+        fStages[fStageCount++] = stage;
+    }
+
+    void blitRow(int left, int right, int y) const {
+        if (left >= right) return;
+        GPixel* dst = fDevice.getAddr(left, y);
+        if (fShader == nullptr) {
+            //A solid source is a single pixel, so the whole span is one chunk
+            fBlend(&fColor, dst, right - left);
+            return;
+        }
+        GPixel chunk[kChunkSize];
+        for (int x = left; x < right; x += kChunkSize) {
+            int count = std::min((int)kChunkSize, right - x);
+            for (int s = 0; s < fStageCount; s++) {
+                fStages[s](*this, x, y, count, chunk, dst);
+            }
+            dst += count;
+        }
+    }
+
+    //Blends the span as blitRow would, then keeps only coverage/255 of the result
+    void blitRowCoverage(int left, int right, int y, unsigned coverage) const {
+        if (left >= right) return;
+        GPixel* dst = fDevice.getAddr(left, y);
+        if (fShader == nullptr && fMode == GBlendMode::kSrcOver) {
+            //c * (S + (1 - Sa) * D) + (1 - c) * D is src-over of the color scaled by c
+            GPixel color = GPixel_PackARGB(div255(coverage * GPixel_GetA(fColor)), div255(coverage * GPixel_GetR(fColor)),
+                                           div255(coverage * GPixel_GetG(fColor)), div255(coverage * GPixel_GetB(fColor)));
+            pickBlend(fMode, GPixel_GetA(color), false)(&color, dst, right - left);
+            return;
+        }
+        GPixel chunk[kChunkSize];
+        GPixel blended[kChunkSize];
+        for (int x = left; x < right; x += kChunkSize) {
+            int count = std::min((int)kChunkSize, right - x);
+            std::copy(dst, dst + count, blended);
+            if (fShader == nullptr) {
+                fBlend(&fColor, blended, count);
+            }
+            else {
+                for (int s = 0; s < fStageCount; s++) {
+                    fStages[s](*this, x, y, count, chunk, blended);
+                }
+            }
+            lerpRow(blended, dst, count, coverage);
+            dst += count;
+        }
+    }
+
+    GShader* shader() const { return fShader; }
+    GPixel color() const { return fColor; }
+    BlendFunction blend() const { return fBlend; }
+
+private:
+
+    static void shadeStage(const ZPipeline& p, int x, int y, int count, GPixel chunk[], GPixel* dst) {
+        p.fShader->shadeRow(x, y, count, chunk);
+    }
+
+    static void blendStage(const ZPipeline& p, int x, int y, int count, GPixel chunk[], GPixel* dst) {
+        p.fBlend(chunk, dst, count);
+    }
+
+    const GBitmap& fDevice;
+    GShader* fShader;
+    GBlendMode fMode;
+    GPixel fColor;
+    BlendFunction fBlend;
+    Stage fStages[kMaxStages];
+    int fStageCount;
+
+};
+
+#endif
@@ -0,0 +1,446 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZSampler_DEFINED
+#define ZSampler_DEFINED
+
+#include "GBitmap.h"
+#include "GShader.h"
+#include "ZBlockedBitmap.h"
+#include "ZSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Nearest sampling for the bitmap shader. The device to bitmap mapping is affine, so along a
+ *  row the texel coordinates (u, v) move by the same step from one pixel to the next. They are
+ *  mapped once for the first pixel of a row and then stepped in 16.16 fixed point; a texel is
+ *  the integer part of (u, v), tiled into the bitmap.
+ */
+
+/**
+ *  Tiling along one axis of the bitmap, for texel indices that fit in an int. Repeat and
+ *  mirror wrap into their period (n, or 2n for mirror) with a float estimate of the quotient,
+ *  which can be off by one, so the remainder is corrected once in either direction.
+ */
+struct ZTileAxis {
+    int n;
+    int period;
+    float invPeriod;
+
+    void set(int size, GShader::TileMode mode) {
+        n = size;
+        period = mode == GShader::kMirror ? 2 * size : size;
+        invPeriod = 1.0f / period;
+    }
+};
+
+static inline int wrapTexel(int i, const ZTileAxis& axis) {
+    int r = i - (int)(i * axis.invPeriod) * axis.period;
+    if (r < 0) r += axis.period;
+    if (r >= axis.period) r -= axis.period;
+    return r;
+}
+
+template <GShader::TileMode mode> static inline int tileTexel(int i, const ZTileAxis& axis) {
+    if (mode == GShader::kClamp) return std::max(0, std::min(axis.n - 1, i));
+    int r = wrapTexel(i, axis);
+    //Mirror: [n, 2n) runs back down from n - 1 to 0
+    return mode == GShader::kMirror ? std::min(r, axis.period - 1 - r) : r;
+}
+
+//The same tiling for texel indices too far out for an int (only reached for huge coordinates)
+template <GShader::TileMode mode> static inline int tileTexel64(int64_t i, const ZTileAxis& axis) {
+    if (mode == GShader::kClamp) return (int)std::max<int64_t>(0, std::min<int64_t>(axis.n - 1, i));
+    int64_t r = i % axis.period;
+    if (r < 0) r += axis.period;
+    return (int)(mode == GShader::kMirror ? std::min<int64_t>(r, axis.period - 1 - r) : r);
+}
+
+#if defined(__AVX2__)
+
+static inline __m256i wrapTexels(__m256i i, __m256i period, __m256 invPeriod) {
+    __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(i), invPeriod));
+    __m256i r = _mm256_sub_epi32(i, _mm256_mullo_epi32(q, period));
+    r = _mm256_add_epi32(r, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), r), period));
+    return _mm256_sub_epi32(r, _mm256_andnot_si256(_mm256_cmpgt_epi32(period, r), period));
+}
+
+//tileTexel, eight lanes at a time
+template <GShader::TileMode mode> static inline __m256i tileTexels(__m256i i, const ZTileAxis& axis) {
+    if (mode == GShader::kClamp) {
+        return _mm256_min_epi32(_mm256_max_epi32(i, _mm256_setzero_si256()), _mm256_set1_epi32(axis.n - 1));
+    }
+    __m256i period = _mm256_set1_epi32(axis.period);
+    __m256i r = wrapTexels(i, period, _mm256_set1_ps(axis.invPeriod));
+    if (mode == GShader::kMirror) {
+        r = _mm256_min_epi32(r, _mm256_sub_epi32(_mm256_sub_epi32(period, _mm256_set1_epi32(1)), r));
+    }
+    return r;
+}
+
+#endif
+
+//Row-major texels, indexed the way ZBlockedBitmap indexes its blocks
+struct ZRowLayout {
+    int stride;
+
+    int index(int x, int y) const { return y * stride + x; }
+
+#if defined(__AVX2__)
+    __m256i index(__m256i x, __m256i y) const {
+        return _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(stride)), x);
+    }
+#endif
+};
+
+/**
+ *  Fill row with count texels, starting at (u, v) and stepping by (du, dv), all in 16.16.
+ *  Rows whose coordinates all stay within +/-16384 texels (every row, once repeat and mirror
+ *  have taken whole periods off of the start) are stepped in 32 bits, eight pixels at a time
+ *  with a gather when AVX2 is enabled. layout finds a texel's offset from pixels.
+ */
+template <GShader::TileMode mode, typename Layout>
+static void sampleTexels(const GPixel pixels[], const Layout& layout, const ZTileAxis& xAxis, const ZTileAxis& yAxis,
+                         int64_t u, int64_t v, int64_t du, int64_t dv, int count, GPixel row[]) {
+    const int64_t limit = (int64_t)1 << 30;
+    int64_t uEnd = u + du * (count - 1);
+    int64_t vEnd = v + dv * (count - 1);
+    bool fits = std::max(std::abs(u), std::abs(uEnd)) < limit && std::max(std::abs(v), std::abs(vEnd)) < limit &&
+                std::abs(du) < limit && std::abs(dv) < limit;
+    if (!fits) {
+        for (int i = 0; i < count; i++, u += du, v += dv) {
+            row[i] = pixels[layout.index(tileTexel64<mode>(u >> 16, xAxis), tileTexel64<mode>(v >> 16, yAxis))];
+        }
+        return;
+    }
+    int fu = (int)u, fv = (int)v;
+    const int fdu = (int)du, fdv = (int)dv;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vu = _mm256_add_epi32(_mm256_set1_epi32(fu), _mm256_mullo_epi32(_mm256_set1_epi32(fdu), lanes));
+    __m256i vv = _mm256_add_epi32(_mm256_set1_epi32(fv), _mm256_mullo_epi32(_mm256_set1_epi32(fdv), lanes));
+    //Lanes wrap like unsigned ints, so are right whenever the step they are taking lands in range
+    const __m256i stepU = _mm256_slli_epi32(_mm256_set1_epi32(fdu), 3);
+    const __m256i stepV = _mm256_slli_epi32(_mm256_set1_epi32(fdv), 3);
+    for (; i + 8 <= count; i += 8) {
+        __m256i tx = tileTexels<mode>(_mm256_srai_epi32(vu, 16), xAxis);
+        __m256i ty = tileTexels<mode>(_mm256_srai_epi32(vv, 16), yAxis);
+        _mm256_storeu_si256((__m256i*)(row + i), _mm256_i32gather_epi32((const int*)pixels, layout.index(tx, ty), 4));
+        vu = _mm256_add_epi32(vu, stepU);
+        vv = _mm256_add_epi32(vv, stepV);
+    }
+    fu = (int)(u + du * i);
+    fv = (int)(v + dv * i);
+#endif
+    for (; i < count; i++, fu += fdu, fv += fdv) {
+        row[i] = pixels[layout.index(tileTexel<mode>(fu >> 16, xAxis), tileTexel<mode>(fv >> 16, yAxis))];
+    }
+}
+
+template <GShader::TileMode mode>
+static void sampleNearest(const GBitmap& bm, const ZTileAxis& xAxis, const ZTileAxis& yAxis,
+                          int64_t u, int64_t v, int64_t du, int64_t dv, int count, GPixel row[]) {
+    sampleTexels<mode>(bm.pixels(), ZRowLayout{ (int)(bm.rowBytes() >> 2) }, xAxis, yAxis, u, v, du, dv, count, row);
+}
+
+//sampleNearest, from the blocks of a bitmap
+template <GShader::TileMode mode>
+static void sampleBlocked(const ZBlockedBitmap& blocks, const ZTileAxis& xAxis, const ZTileAxis& yAxis,
+                          int64_t u, int64_t v, int64_t du, int64_t dv, int count, GPixel row[]) {
+    sampleTexels<mode>(blocks.pixels(), blocks, xAxis, yAxis, u, v, du, dv, count, row);
+}
+
+/**
+ *  Bilinear sampling blends the four texels whose centers surround (u, v), so it samples at
+ *  (u - 1/2, v - 1/2): the integer parts pick the top left texel, and the top 8 bits of the
+ *  fractions weigh it against its neighbors. Rows are blended first, then the two rows, each
+ *  rounded back to 8 bits per channel, which keeps every step within 16 bits for the wide
+ *  loops. Blending premultiplied texels keeps each channel at most its alpha.
+ */
+
+//(a * (256 - w) + b * w + 128) >> 8 per channel, two channels per multiply
+static inline GPixel lerpPixel(GPixel a, GPixel b, unsigned w) {
+    const uint32_t mask = 0x00FF00FF;
+    uint32_t rb = ((a & mask) * (256 - w) + (b & mask) * w + 0x00800080) >> 8;
+    uint32_t ag = ((a >> 8) & mask) * (256 - w) + ((b >> 8) & mask) * w + 0x00800080;
+    return (rb & mask) | (ag & ~mask);
+}
+
+template <GShader::TileMode mode, typename Int>
+static inline GPixel bilerp(const GPixel pixels[], int stride, const ZTileAxis& xAxis, const ZTileAxis& yAxis, Int u, Int v) {
+    u -= 1 << 15;
+    v -= 1 << 15;
+    int x0, x1, y0, y1;
+    if (sizeof(Int) == sizeof(int)) {
+        x0 = tileTexel<mode>((int)(u >> 16), xAxis);
+        x1 = tileTexel<mode>((int)(u >> 16) + 1, xAxis);
+        y0 = tileTexel<mode>((int)(v >> 16), yAxis);
+        y1 = tileTexel<mode>((int)(v >> 16) + 1, yAxis);
+    } else {
+        x0 = tileTexel64<mode>((u >> 16), xAxis);
+        x1 = tileTexel64<mode>((u >> 16) + 1, xAxis);
+        y0 = tileTexel64<mode>((v >> 16), yAxis);
+        y1 = tileTexel64<mode>((v >> 16) + 1, yAxis);
+    }
+    unsigned wx = (unsigned)(u >> 8) & 0xFF;
+    unsigned wy = (unsigned)(v >> 8) & 0xFF;
+    const GPixel* row0 = pixels + y0 * stride;
+    const GPixel* row1 = pixels + y1 * stride;
+    return lerpPixel(lerpPixel(row0[x0], row0[x1], wx), lerpPixel(row1[x0], row1[x1], wx), wy);
+}
+
+#if defined(__AVX2__)
+
+//The weights of eight samples (already less 1/2), for ZVec8::Lerp
+static inline __m256i bilerpWeights(__m256i s) {
+    __m256i w = _mm256_and_si256(_mm256_srli_epi32(s, 8), _mm256_set1_epi32(0xFF));
+    return _mm256_or_si256(w, _mm256_slli_epi32(w, 16));
+}
+
+//Even and odd pixels of a and b, in order, when a holds pairs 0, 1, 4, 5 and b pairs 2, 3, 6, 7
+static inline __m256i evenPixels(__m256i a, __m256i b) {
+    return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static inline __m256i oddPixels(__m256i a, __m256i b) {
+    return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+static inline __m128i evenPixels(__m128i a, __m128i b) {
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static inline __m128i oddPixels(__m128i a, __m128i b) {
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+#endif
+
+/**
+ *  Bilinear samples that are all at least a texel inside of the bitmap, so the texels right
+ *  of each one are next to it, and the two rows a stride apart. Each pair is read as one 64
+ *  bit load (or gather) and split into its left and right texels.
+ */
+static void bilerpInterior(const GPixel pixels[], int stride, int u, int v, int du, int dv, int count, GPixel row[]) {
+    u -= 1 << 15;
+    v -= 1 << 15;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    //Gathers fill 64 bit lanes within 128 bit halves, so their indices go in the order that
+    //leaves the split pixels in order
+    const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+    __m256i vu = _mm256_add_epi32(_mm256_set1_epi32(u), _mm256_mullo_epi32(_mm256_set1_epi32(du), lanes));
+    __m256i vv = _mm256_add_epi32(_mm256_set1_epi32(v), _mm256_mullo_epi32(_mm256_set1_epi32(dv), lanes));
+    const __m256i stepU = _mm256_slli_epi32(_mm256_set1_epi32(du), 3);
+    const __m256i stepV = _mm256_slli_epi32(_mm256_set1_epi32(dv), 3);
+    const __m256i rowStride = _mm256_set1_epi32(stride);
+    const long long* base = (const long long*)pixels;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(vv, 16), rowStride), _mm256_srai_epi32(vu, 16));
+        index = _mm256_permutevar8x32_epi32(index, order);
+        __m256i below = _mm256_add_epi32(index, rowStride);
+        __m256i t0 = _mm256_i32gather_epi64(base, _mm256_castsi256_si128(index), 4);
+        __m256i t1 = _mm256_i32gather_epi64(base, _mm256_extracti128_si256(index, 1), 4);
+        __m256i b0 = _mm256_i32gather_epi64(base, _mm256_castsi256_si128(below), 4);
+        __m256i b1 = _mm256_i32gather_epi64(base, _mm256_extracti128_si256(below, 1), 4);
+        __m256i wx = bilerpWeights(vu);
+        __m256i wy = bilerpWeights(vv);
+        __m256i top = ZVec8::Lerp(evenPixels(t0, t1), oddPixels(t0, t1), wx);
+        __m256i bottom = ZVec8::Lerp(evenPixels(b0, b1), oddPixels(b0, b1), wx);
+        ZVec8::Store(row + i, ZVec8::Lerp(top, bottom, wy));
+        vu = _mm256_add_epi32(vu, stepU);
+        vv = _mm256_add_epi32(vv, stepV);
+    }
+    u += du * i;
+    v += dv * i;
+#endif
+#if defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128i t[4], b[4];
+        int w[2][4];
+        for (int k = 0; k < 4; k++, u += du, v += dv) {
+            const GPixel* p = pixels + (v >> 16) * stride + (u >> 16);
+            t[k] = _mm_loadl_epi64((const __m128i*)p);
+            b[k] = _mm_loadl_epi64((const __m128i*)(p + stride));
+            w[0][k] = ((u >> 8) & 0xFF) * 0x10001;
+            w[1][k] = ((v >> 8) & 0xFF) * 0x10001;
+        }
+        __m128i t01 = _mm_unpacklo_epi64(t[0], t[1]), t23 = _mm_unpacklo_epi64(t[2], t[3]);
+        __m128i b01 = _mm_unpacklo_epi64(b[0], b[1]), b23 = _mm_unpacklo_epi64(b[2], b[3]);
+        __m128i wx = _mm_setr_epi32(w[0][0], w[0][1], w[0][2], w[0][3]);
+        __m128i wy = _mm_setr_epi32(w[1][0], w[1][1], w[1][2], w[1][3]);
+        __m128i top = ZVec4::Lerp(evenPixels(t01, t23), oddPixels(t01, t23), wx);
+        __m128i bottom = ZVec4::Lerp(evenPixels(b01, b23), oddPixels(b01, b23), wx);
+        ZVec4::Store(row + i, ZVec4::Lerp(top, bottom, wy));
+    }
+#endif
+    for (; i < count; i++, u += du, v += dv) {
+        const GPixel* p = pixels + (v >> 16) * stride + (u >> 16);
+        unsigned wx = (u >> 8) & 0xFF;
+        row[i] = lerpPixel(lerpPixel(p[0], p[1], wx), lerpPixel(p[stride], p[stride + 1], wx), (v >> 8) & 0xFF);
+    }
+}
+
+//sampleNearest, blending the four texels around each sample
+template <GShader::TileMode mode>
+static void sampleBilinear(const GBitmap& bm, const ZTileAxis& xAxis, const ZTileAxis& yAxis,
+                           int64_t u, int64_t v, int64_t du, int64_t dv, int count, GPixel row[]) {
+    const GPixel* pixels = bm.pixels();
+    const int stride = (int)(bm.rowBytes() >> 2);
+    const int64_t limit = (int64_t)1 << 30;
+    int64_t uEnd = u + du * (count - 1);
+    int64_t vEnd = v + dv * (count - 1);
+    bool fits = std::max(std::abs(u), std::abs(uEnd)) < limit && std::max(std::abs(v), std::abs(vEnd)) < limit &&
+                std::abs(du) < limit && std::abs(dv) < limit;
+    if (!fits) {
+        for (int i = 0; i < count; i++, u += du, v += dv) {
+            row[i] = bilerp<mode>(pixels, stride, xAxis, yAxis, u, v);
+        }
+        return;
+    }
+    //Rows whose samples never reach an edge need no tiling, and find each pair of texels side
+    //by side in memory
+    int64_t left = (std::min(u, uEnd) - (1 << 15)) >> 16, right = (std::max(u, uEnd) - (1 << 15)) >> 16;
+    int64_t top = (std::min(v, vEnd) - (1 << 15)) >> 16, bottom = (std::max(v, vEnd) - (1 << 15)) >> 16;
+    if (left >= 0 && right <= bm.width() - 2 && top >= 0 && bottom <= bm.height() - 2) {
+        bilerpInterior(pixels, stride, (int)u, (int)v, (int)du, (int)dv, count, row);
+        return;
+    }
+    int fu = (int)u, fv = (int)v;
+    const int fdu = (int)du, fdv = (int)dv;
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i half = _mm256_set1_epi32(1 << 15);
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i vu = _mm256_sub_epi32(_mm256_add_epi32(_mm256_set1_epi32(fu), _mm256_mullo_epi32(_mm256_set1_epi32(fdu), lanes)), half);
+    __m256i vv = _mm256_sub_epi32(_mm256_add_epi32(_mm256_set1_epi32(fv), _mm256_mullo_epi32(_mm256_set1_epi32(fdv), lanes)), half);
+    const __m256i stepU = _mm256_slli_epi32(_mm256_set1_epi32(fdu), 3);
+    const __m256i stepV = _mm256_slli_epi32(_mm256_set1_epi32(fdv), 3);
+    const __m256i rowStride = _mm256_set1_epi32(stride);
+    for (; i + 8 <= count; i += 8) {
+        __m256i ix = _mm256_srai_epi32(vu, 16);
+        __m256i iy = _mm256_srai_epi32(vv, 16);
+        __m256i x0 = tileTexels<mode>(ix, xAxis);
+        __m256i x1 = tileTexels<mode>(_mm256_add_epi32(ix, one), xAxis);
+        __m256i y0 = _mm256_mullo_epi32(tileTexels<mode>(iy, yAxis), rowStride);
+        __m256i y1 = _mm256_mullo_epi32(tileTexels<mode>(_mm256_add_epi32(iy, one), yAxis), rowStride);
+        const int* base = (const int*)pixels;
+        __m256i p00 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y0, x0), 4);
+        __m256i p10 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y0, x1), 4);
+        __m256i p01 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y1, x0), 4);
+        __m256i p11 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y1, x1), 4);
+        __m256i wx = bilerpWeights(vu);
+        __m256i wy = bilerpWeights(vv);
+        ZVec8::Store(row + i, ZVec8::Lerp(ZVec8::Lerp(p00, p10, wx), ZVec8::Lerp(p01, p11, wx), wy));
+        vu = _mm256_add_epi32(vu, stepU);
+        vv = _mm256_add_epi32(vv, stepV);
+    }
+    fu = (int)(u + du * i);
+    fv = (int)(v + dv * i);
+#endif
+#if defined(__SSE2__)
+    //Without a gather the texels are fetched one by one, and only blended four at a time
+    for (; i + 4 <= count; i += 4) {
+        GPixel p[4][4];
+        int w[2][4];
+        for (int k = 0; k < 4; k++, fu += fdu, fv += fdv) {
+            int su = fu - (1 << 15), sv = fv - (1 << 15);
+            int x0 = tileTexel<mode>(su >> 16, xAxis);
+            int x1 = tileTexel<mode>((su >> 16) + 1, xAxis);
+            const GPixel* row0 = pixels + tileTexel<mode>(sv >> 16, yAxis) * stride;
+            const GPixel* row1 = pixels + tileTexel<mode>((sv >> 16) + 1, yAxis) * stride;
+            p[0][k] = row0[x0];
+            p[1][k] = row0[x1];
+            p[2][k] = row1[x0];
+            p[3][k] = row1[x1];
+            w[0][k] = ((su >> 8) & 0xFF) * 0x10001;
+            w[1][k] = ((sv >> 8) & 0xFF) * 0x10001;
+        }
+        //Built from registers, as loading what was just stored a pixel at a time would stall
+        ZVec4::V q[4];
+        for (int j = 0; j < 4; j++) {
+            q[j] = _mm_setr_epi32((int)p[j][0], (int)p[j][1], (int)p[j][2], (int)p[j][3]);
+        }
+        ZVec4::V wx = _mm_setr_epi32(w[0][0], w[0][1], w[0][2], w[0][3]);
+        ZVec4::V wy = _mm_setr_epi32(w[1][0], w[1][1], w[1][2], w[1][3]);
+        ZVec4::Store(row + i, ZVec4::Lerp(ZVec4::Lerp(q[0], q[1], wx), ZVec4::Lerp(q[2], q[3], wx), wy));
+    }
+#endif
+    for (; i < count; i++, fu += fdu, fv += fdv) {
+        row[i] = bilerp<mode>(pixels, stride, xAxis, yAxis, fu, fv);
+    }
+}
+
+/**
+ *  A bitmap that is only translated lines up with the device pixel for pixel, so the texels of
+ *  a row are a run of one of its rows, starting at texel x. The run is copied straight out of
+ *  the bitmap: clamped ends are filled with the edge texels, and repeats are copied a period at
+ *  a time.
+ */
+template <GShader::TileMode mode> static void copyTranslated(const GPixel src[], int n, int x, int count, GPixel row[]) {
+    if (mode == GShader::kClamp) {
+        int before = std::min(count, std::max(0, -x));
+        std::fill(row, row + before, src[0]);
+        int start = x + before;
+        int inside = start < n ? std::min(count - before, n - start) : 0;
+        if (inside > 0) std::copy(src + start, src + start + inside, row + before);
+        std::fill(row + before + inside, row + count, src[n - 1]);
+        return;
+    }
+    int start = x % n;
+    if (start < 0) start += n;
+    for (int i = 0; i < count; start = 0) {
+        int run = std::min(count - i, n - start);
+        std::copy(src + start, src + start + run, row + i);
+        i += run;
+    }
+}
+
+/**
+ *  For a bitmap that is only scaled (and translated), the texel x of a device column is the
+ *  same on every row, so it is looked up in a table built once per context. Clamp tables run
+ *  a column past either side of the bitmap, and columns beyond them take their ends. Repeat
+ *  and mirror tables hold one period of the tiling, from column 0, and only exist when that
+ *  period is a whole number of columns.
+ */
+struct ZColumnTable {
+    std::vector<int> texels;
+    int start;
+    bool periodic;
+};
+
+static void sampleColumns(const GPixel src[], const ZColumnTable& table, int x, int count, GPixel row[]) {
+    const int* texels = table.texels.data();
+    const int size = (int)table.texels.size();
+    int j = x - table.start;
+    if (!table.periodic) {
+        int before = std::min(count, std::max(0, -j));
+        std::fill(row, row + before, src[texels[0]]);
+        int i = before;
+        for (int end = std::min(count, size - j); i < end; i++) {
+            row[i] = src[texels[j + i]];
+        }
+        std::fill(row + i, row + count, src[texels[size - 1]]);
+        return;
+    }
+    j %= size;
+    if (j < 0) j += size;
+    for (int i = 0; i < count; i++) {
+        row[i] = src[texels[j]];
+        if (++j == size) j = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZScan_DEFINED
+#define ZScan_DEFINED
+
+#include "GMath.h"
+#include "GPoint.h"
+#include "GRect.h"
+#include "ZEdge.h"
+#include "ZBlitter.h"
+
+#include <algorithm>
+#include <vector>
+
+//Buffers a scan reuses from path to path, so it only allocates while they grow
+struct ZScanBuffers {
+    std::vector<Edge> sorted;
+    std::vector<int> starts;
+    std::vector<Edge> active;
+};
+
+/**
+ *  Order the edges by their top row with a counting sort, so the scan can add edges to the
+ *  active list in O(1) each. Returns false if there is nothing to scan.
+ */
+static bool bucketEdges(const std::vector<Edge>& edges, std::vector<Edge>& sorted, std::vector<int>& starts, int* top, int* bottom) {
+    if (edges.size() < 2) return false;
+    int upper = edges[0].top;
+    int lower = edges[0].bottom;
+    for (const Edge& e : edges) {
+        upper = std::min(upper, e.top);
+        lower = std::max(lower, e.bottom);
+    }
+    starts.assign(lower - upper + 1, 0);
+    for (const Edge& e : edges) {
+        starts[e.top - upper + 1]++;
+    }
+    for (size_t i = 1; i < starts.size(); i++) {
+        starts[i] += starts[i - 1];
+    }
+    sorted.resize(edges.size());
+    for (const Edge& e : edges) {
+        sorted[starts[e.top - upper]++] = e;
+    }
+    *top = upper;
+    *bottom = lower;
+    return true;
+}
+
+/**
+ *  Fill rows [top, bottom) of edges sorted by bucketEdges with the non-zero winding rule. The
+ *  active list is kept sorted by x with an insertion sort (it is nearly sorted from the
+ *  previous row), and edges that end are removed in a single compaction pass, so a path costs
+ *  O(edges + spans) plus the rare reorderings.
+ *
+ *  Edges that start above top are advanced to it in fixed point, so scanning a path in bands
+ *  of rows blits exactly the spans of a single scan.
+ *
+ *  Spans are blitted with x in units of 1 / (1 << shiftX) pixels, which lets the anti-aliased
+ *  fill take its horizontal samples from the fixed point x instead of scaling the geometry.
+ */
+template <int shiftX = 0>
+static void scanRows(const Edge sorted[], size_t count, int top, int bottom, ZBlitter* blitter, std::vector<Edge>& active) {
+    active.clear();
+    size_t next = 0;
+    for (; next < count && sorted[next].top < top; next++) {
+        Edge e = sorted[next];
+        if (e.bottom <= top) continue;
+        e.x = (int)(e.x + (int64_t)(top - e.top) * e.dx);
+        e.top = top;
+        active.push_back(e);
+    }
+
+    for (int y = top; y < bottom; y++) {
+        if (active.empty()) {
+            if (next == count) break;
+            y = std::max(y, sorted[next].top);
+            if (y >= bottom) break;
+        }
+        while (next < count && sorted[next].top <= y) {
+            active.push_back(sorted[next++]);
+        }
+
+        for (size_t i = 1; i < active.size(); i++) {
+            Edge e = active[i];
+            size_t j = i;
+            for (; j > 0 && active[j - 1].x > e.x; j--) {
+                active[j] = active[j - 1];
+            }
+            active[j] = e;
+        }
+
+        int w = 0;
+        int left = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < active.size(); i++) {
+            Edge& e = active[i];
+            int x = (e.x + (1 << (15 - shiftX))) >> (16 - shiftX);
+            if (w == 0) left = x;
+            w += e.w;
+            if (w == 0 && left < x) blitter->blitH(left, y, x - left);
+            if (e.bottom > y + 1) {
+                e.x += e.dx;
+                active[kept++] = e;
+            }
+        }
+        active.resize(kept);
+    }
+}
+
+/**
+ *  Fill a triangle in device space without building, sorting or clipping an edge list. Its
+ *  edges are stepped in the same fixed point as edges made by createEdge, from the same rows,
+ *  so the triangle covers exactly the pixels of a path of it. Every row of a triangle crosses
+ *  exactly two edges, and the clip only bounds the rows and the spans.
+ */
+static void scanTriangle(const GPoint pts[3], const GIRect& clip, ZBlitter* blitter) {
+    struct TriangleEdge {
+        int64_t x; //16.16 x at the center of row top
+        int64_t dx;
+        int top;
+        int bottom;
+    };
+    TriangleEdge edges[3];
+    int rows[3];
+    for (int i = 0; i < 3; i++) {
+        rows[i] = fastRoundToInt(std::max(-kMaxFixed, std::min(kMaxFixed, pts[i].y())));
+    }
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        //In the order of the path, as the line's b depends on which end it is measured from
+        int j = i == 2 ? 0 : i + 1;
+        GPoint p1 = pts[i];
+        GPoint p2 = pts[j];
+        TriangleEdge& e = edges[count];
+        e.top = std::min(rows[i], rows[j]);
+        e.bottom = std::max(rows[i], rows[j]);
+        if (e.top == e.bottom) continue;
+        float m = (p2.x() - p1.x()) / (p2.y() - p1.y());
+        float b = p1.x() - m * p1.y();
+        e.x = floatToFixed(m * (e.top + 0.5f) + b);
+        e.dx = floatToFixed(m);
+        count++;
+    }
+    if (count < 2) return;
+    //One edge spans every row, and the others split those rows between them
+    int longest = 0;
+    for (int i = 1; i < count; i++) {
+        if (edges[i].bottom - edges[i].top > edges[longest].bottom - edges[longest].top) longest = i;
+    }
+    const TriangleEdge& l = edges[longest];
+    const int64_t left = (int64_t)clip.fLeft << 16;
+    const int64_t right = (int64_t)clip.fRight << 16;
+    for (int i = 0; i < count; i++) {
+        if (i == longest) continue;
+        const TriangleEdge& e = edges[i];
+        int y = std::max(e.top, clip.fTop);
+        int stop = std::min(e.bottom, clip.fBottom);
+        int64_t x0 = l.x + (y - l.top) * l.dx;
+        int64_t x1 = e.x + (y - e.top) * e.dx;
+        for (; y < stop; y++, x0 += l.dx, x1 += e.dx) {
+            int a = fixedRoundToInt((int)std::max(left, std::min(right, std::min(x0, x1))));
+            int b = fixedRoundToInt((int)std::max(left, std::min(right, std::max(x0, x1))));
+            if (a < b) blitter->blitH(a, y, b - a);
+        }
+    }
+}
+
+template <int shiftX = 0>
+static void scanPath(const std::vector<Edge>& edges, ZBlitter* blitter, ZScanBuffers& buffers) {
+    int top, bottom;
+    if (!bucketEdges(edges, buffers.sorted, buffers.starts, &top, &bottom)) return;
+    scanRows<shiftX>(buffers.sorted.data(), buffers.sorted.size(), top, bottom, blitter, buffers.active);
+}
+
+#endif
@@ -6,63 +6,252 @@
 #include "GBitmap.h"
 #include "GPoint.h"
 #include "GMatrix.h"
-#include "ZTileable.h"
+#include "ZMipmap.h"
+#include "ZSampler.h"
+
+#include <cmath>
 
 class ZShader : public GShader {
 
 public:
 
-    ZShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode) {
+    ZShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode, GFilterQuality filter, bool blocked = false) {
         bm = localBm;
         lm = localM;
+        this->tileMode = tileMode;
+        this->filter = filter;
+        this->blocked = blocked;
+        kind = kGeneral;
+        dx = 0;
+        filledFrom = filledTo = 0;
+        if (blocked) {
+            //Only the blocks, a copy made now, are read from here on
+            blocks.build(bm);
+            xAxis.set(blocks.width(), tileMode);
+            yAxis.set(blocks.height(), tileMode);
+        } else {
+            if (filter == GFilterQuality::kMipmap) {
+                //Every level, the full size one included, is sampled from the pyramid's copy
+                mipmap.build(bm);
+                bm = mipmap.level(0);
+            }
+            sampled = bm;
+            xAxis.set(bm.width(), tileMode);
+            yAxis.set(bm.height(), tileMode);
+        }
+        bool bilinear = filter != GFilterQuality::kNearest;
         switch(tileMode) {
             default:
             case kClamp:
-                tileFunction = &clamp;
+                sampleFunction = bilinear ? &sampleBilinear<kClamp> : &sampleNearest<kClamp>;
+                blockedFunction = &sampleBlocked<kClamp>;
                 break;
             case kRepeat:
-                tileFunction = &repeat;
+                sampleFunction = bilinear ? &sampleBilinear<kRepeat> : &sampleNearest<kRepeat>;
+                blockedFunction = &sampleBlocked<kRepeat>;
                 break;
             case kMirror:
-                tileFunction = &mirror;
+                sampleFunction = bilinear ? &sampleBilinear<kMirror> : &sampleNearest<kMirror>;
+                blockedFunction = &sampleBlocked<kMirror>;
                 break;
         }
     }
 
     bool isOpaque() {
-        return false;
+        return blocked ? blocks.isOpaque() : bm.isOpaque();
     }
 
+    //tm takes device space straight to the texels of the sampled bitmap (a mip level, when
+    //mipmapping). A bitmap that is only translated, or only scaled, has a cheaper way to shade
+    //its rows than stepping through the bitmap. A scaled one's column table is only laid out
+    //here; shadeRow fills in the columns it draws, since a mesh sets a context per triangle.
+    //Filtering a bitmap translated by whole texels finds every pixel on a texel center, so it
+    //is copied as well. A blocked shader always samples its blocks, so it never mixes them
+    //with the bitmap's current pixels.
     bool setContext(const GMatrix& ctm) {
-        GMatrix actualTm = GMatrix::Concat(ctm, lm);
-        return GMatrix::Concat(actualTm, GMatrix(bm.width(), 0, 0, 0, bm.height(), 0)).invert(&tm);
+        if (!GMatrix::Concat(ctm, lm).invert(&tm)) return false;
+        kind = kGeneral;
+        if (blocked) return true;
+        sampled = bm;
+        if (filter == GFilterQuality::kMipmap) chooseLevel();
+        xAxis.set(sampled.width(), tileMode);
+        yAxis.set(sampled.height(), tileMode);
+        if (tm[GMatrix::KX] != 0 || tm[GMatrix::KY] != 0) return true;
+        bool bilinear = filter != GFilterQuality::kNearest;
+        if (bilinear && (tm[GMatrix::TX] != std::floor(tm[GMatrix::TX]) || tm[GMatrix::TY] != std::floor(tm[GMatrix::TY]))) return true;
+        if (tm[GMatrix::SX] == 1 && tm[GMatrix::SY] == 1 && tileMode != kMirror && std::abs(tm[GMatrix::TX]) < kMaxOffset) {
+            //floor(x + 0.5 + tx) is x plus a whole number of texels
+            kind = kTranslate;
+            dx = (int)std::floor(tm[GMatrix::TX] + 0.5f);
+            return true;
+        }
+        if (!bilinear && sizeColumns()) kind = kScale;
+        return true;
     }
 
     void shadeRow(int x, int y, int count, GPixel row[]) {
-        GPoint ptsSrc[count];
-        GPoint ptsDst[count];
-        for (int i = 0; i < count; i++) {
-            ptsSrc[i] = GPoint::Make(x + i + 0.5, y + 0.5);
+        if (kind != kGeneral) {
+            //Every pixel of the row is on the same row of the bitmap
+            const GPixel* src = sampled.getAddr(0, tile(tm[GMatrix::SY] * (y + 0.5) + tm[GMatrix::TY], yAxis));
+            if (kind == kScale) {
+                fillColumns(x, count);
+                sampleColumns(src, columns, x, count, row);
+            } else if (tileMode == kClamp) {
+                copyTranslated<kClamp>(src, sampled.width(), x + dx, count, row);
+            } else {
+                copyTranslated<kRepeat>(src, sampled.width(), x + dx, count, row);
+            }
+            return;
+        }
+        //The center of the row's first pixel, in texels. Repeat and mirror look the same a
+        //whole period over, so whole periods are taken off to keep the coordinates small.
+        double cx = x + 0.5, cy = y + 0.5;
+        double u = tm[GMatrix::SX] * cx + tm[GMatrix::KX] * cy + tm[GMatrix::TX];
+        double v = tm[GMatrix::KY] * cx + tm[GMatrix::SY] * cy + tm[GMatrix::TY];
+        if (tileMode != kClamp) {
+            u -= std::floor(u / xAxis.period) * xAxis.period;
+            v -= std::floor(v / yAxis.period) * yAxis.period;
         }
-        tm.mapPoints(ptsDst, ptsSrc, count);
-        for (int i = 0; i < count; i++) {
-            float x = tileFunction(ptsDst[i].x()) * (bm.width());
-            float y = tileFunction(ptsDst[i].y()) * (bm.height());
-            row[i] = *bm.getAddr(floor(x), floor(y));
+        int64_t du = toFixed(tm[GMatrix::SX]), dv = toFixed(tm[GMatrix::KY]);
+        if (blocked) {
+            blockedFunction(blocks, xAxis, yAxis, toFixed(u), toFixed(v), du, dv, count, row);
+        } else {
+            sampleFunction(sampled, xAxis, yAxis, toFixed(u), toFixed(v), du, dv, count, row);
         }
     }
 
 private:
 
+    enum Kind {
+        kGeneral,
+        kTranslate,
+        kScale,
+    };
+
+    //Bounds the size of a table, and keeps offsets far from overflowing an int
+    static constexpr int kMaxColumns = 1024;
+    static constexpr float kMaxOffset = 1 << 30;
+
+    //The texel along an axis that a coordinate falls in
+    int tile(double t, const ZTileAxis& axis) const {
+        int64_t i = (int64_t)std::floor(std::max<double>(-kMaxOffset, std::min<double>(kMaxOffset, t)));
+        switch (tileMode) {
+            default:
+            case kClamp:
+                return tileTexel64<kClamp>(i, axis);
+            case kRepeat:
+                return tileTexel64<kRepeat>(i, axis);
+            case kMirror:
+                return tileTexel64<kMirror>(i, axis);
+        }
+    }
+
+    /**
+     *  A minified draw samples the mip level that has one to two texels per pixel (the level
+     *  after it would have less than one), along whichever direction is minified more, so
+     *  that no texel is skipped over.
+     */
+    void chooseLevel() {
+        float scale = std::max(std::hypot(tm[GMatrix::SX], tm[GMatrix::KY]), std::hypot(tm[GMatrix::KX], tm[GMatrix::SY]));
+        if (!(scale >= 2)) return;
+        sampled = mipmap.level((int)std::min(30.0f, std::log2(scale)));
+        tm = GMatrix::Concat(GMatrix::Scale((float)sampled.width() / bm.width(), (float)sampled.height() / bm.height()), tm);
+    }
+
+    //Lay out the column table for tm, without filling it in
+    bool sizeColumns() {
+        double a = tm[GMatrix::SX], c = tm[GMatrix::TX];
+        double start, size;
+        if (tileMode == kClamp) {
+            //The columns whose centers map into the bitmap, and one more on either side
+            double x0 = -c / a - 0.5, x1 = (bm.width() - c) / a - 0.5;
+            start = std::floor(std::min(x0, x1)) - 1;
+            size = std::ceil(std::max(x0, x1)) + 2 - start;
+        } else {
+            start = 0;
+            size = xAxis.period / std::abs(a);
+            if (!(std::abs(size - std::round(size)) < 1e-4)) return false;
+            size = std::round(size);
+        }
+        if (!(size >= 1 && size <= kMaxColumns && std::abs(start) < kMaxOffset)) return false;
+        columns.texels.resize((int)size);
+        columns.start = (int)start;
+        columns.periodic = tileMode != kClamp;
+        filledFrom = filledTo = 0;
+        return true;
+    }
+
+    //Fill in the entries of the column table that sampleColumns reads for count pixels from x
+    void fillColumns(int x, int count) {
+        const int size = (int)columns.texels.size();
+        int j = x - columns.start;
+        int from = 0, to = size;
+        if (!columns.periodic) {
+            //Pixels past either end take the end's entry
+            from = std::max(0, std::min(size - 1, j));
+            to = std::max(1, std::min(size, j + count));
+        } else if (count < size) {
+            j %= size;
+            if (j < 0) j += size;
+            if (j + count <= size) {
+                from = j;
+                to = j + count;
+            }
+        }
+        if (filledFrom == filledTo) {
+            filledFrom = filledTo = from;
+        }
+        //The filled entries stay one run, so a gap between it and the new ones is filled too
+        for (int i = from; i < filledFrom; i++) {
+            columns.texels[i] = tile(tm[GMatrix::SX] * (columns.start + i + 0.5) + tm[GMatrix::TX], xAxis);
+        }
+        for (int i = filledTo; i < to; i++) {
+            columns.texels[i] = tile(tm[GMatrix::SX] * (columns.start + i + 0.5) + tm[GMatrix::TX], xAxis);
+        }
+        filledFrom = std::min(filledFrom, from);
+        filledTo = std::max(filledTo, to);
+    }
+
+    typedef void (*SampleFunction)(const GBitmap&, const ZTileAxis&, const ZTileAxis&, int64_t, int64_t, int64_t, int64_t, int, GPixel[]);
+    typedef void (*BlockedFunction)(const ZBlockedBitmap&, const ZTileAxis&, const ZTileAxis&, int64_t, int64_t, int64_t, int64_t, int, GPixel[]);
+
+    //To 16.16, pinned well inside of int64_t
+    static int64_t toFixed(double t) {
+        const double limit = 1 << 30;
+        return (int64_t)std::floor(std::max(-limit, std::min(limit, t)) * 65536 + 0.5);
+    }
+
     GMatrix tm;
     GMatrix lm;
     GBitmap bm;
-    TileFunction tileFunction;
+    GBitmap sampled;
+    ZMipmap mipmap;
+    ZBlockedBitmap blocks;
+    TileMode tileMode;
+    GFilterQuality filter;
+    bool blocked;
+    ZTileAxis xAxis;
+    ZTileAxis yAxis;
+    SampleFunction sampleFunction;
+    BlockedFunction blockedFunction;
+    Kind kind;
+    int dx;
+    ZColumnTable columns;
+    int filledFrom;
+    int filledTo;
 
 };
 
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode);
 
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode) {
-    return std::unique_ptr<GShader>(new ZShader(localBm, localM, tileMode));
-}
\ No newline at end of file
+    return std::unique_ptr<GShader>(new ZShader(localBm, localM, tileMode, GFilterQuality::kNearest));
+}
+
+std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode, GFilterQuality filter) {
+    return std::unique_ptr<GShader>(new ZShader(localBm, localM, tileMode, filter));
+}
+
+std::unique_ptr<GShader> GCreateBlockedBitmapShader(const GBitmap& localBm, const GMatrix& localM, GShader::TileMode tileMode) {
+    return std::unique_ptr<GShader>(new ZShader(localBm, localM, tileMode, GFilterQuality::kNearest, true));
+}
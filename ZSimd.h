@@ -0,0 +1,138 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZSimd_DEFINED
+#define ZSimd_DEFINED
+
+#include "GPixel.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ *  Vector helpers for operating on several GPixels at once. Every helper produces the same
+ *  bits as the scalar code in ZBlendMode (div255 below included), so callers can mix the wide
+ *  loops with a scalar tail.
+ *
+ *  SSE2 is always available on x86-64. The AVX2 variant is only compiled when the build
+ *  enables it (e.g. make CPPFLAGS=-mavx2).
+ */
+
+//x / 255, rounded, for x in [0, 255*255]
+static inline unsigned div255(unsigned x) {
+    return (x * 65793 + (1 << 23)) >> 24;
+}
+
+#if defined(__SSE2__)
+
+struct ZVec4 {
+    typedef __m128i V;
+    enum { N = 4 };
+
+    static V Load(const GPixel* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void Store(GPixel* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+    static V Splat(GPixel p) { return _mm_set1_epi32((int)p); }
+    static V Zero() { return _mm_setzero_si128(); }
+    static V Add(V a, V b) { return _mm_add_epi32(a, b); }
+
+    //(x + 128) * 257 >> 16 is exactly div255 for x in [0, 255*255]
+    static V Div255(V x) {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_mulhi_epu16(x, _mm_set1_epi16(257));
+    }
+
+    static V AlphaOf(V px16) {
+        px16 = _mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_shufflehi_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    //alpha(from) * pixel, or (1 - alpha(from)) * pixel when invert is set
+    static V Scale(V pixel, V from, bool invert) {
+        const V zero = _mm_setzero_si128();
+        V lo = _mm_unpacklo_epi8(pixel, zero);
+        V hi = _mm_unpackhi_epi8(pixel, zero);
+        V alo = AlphaOf(_mm_unpacklo_epi8(from, zero));
+        V ahi = AlphaOf(_mm_unpackhi_epi8(from, zero));
+        if (invert) {
+            alo = _mm_sub_epi16(_mm_set1_epi16(255), alo);
+            ahi = _mm_sub_epi16(_mm_set1_epi16(255), ahi);
+        }
+        lo = Div255(_mm_mullo_epi16(lo, alo));
+        hi = Div255(_mm_mullo_epi16(hi, ahi));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    //(a * (256 - w) + b * w + 128) >> 8 per channel, as lerpPixel in ZSampler. Each 32 bit
+    //lane of w holds its pixel's weight (0...256) twice, as w | w << 16. Computed as
+    //a * 256 + (b - a) * w, which wraps in 16 bits but ends in range.
+    static V Lerp(V a, V b, V w) {
+        const V zero = _mm_setzero_si128();
+        const V half = _mm_set1_epi16(128);
+        V alo = _mm_unpacklo_epi8(a, zero);
+        V ahi = _mm_unpackhi_epi8(a, zero);
+        V lo = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(b, zero), alo), _mm_unpacklo_epi32(w, w));
+        V hi = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(b, zero), ahi), _mm_unpackhi_epi32(w, w));
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(alo, 8), lo), half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(ahi, 8), hi), half), 8);
+        return _mm_packus_epi16(lo, hi);
+    }
+};
+
+#endif
+
+#if defined(__AVX2__)
+
+struct ZVec8 {
+    typedef __m256i V;
+    enum { N = 8 };
+
+    static V Load(const GPixel* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void Store(GPixel* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static V Splat(GPixel p) { return _mm256_set1_epi32((int)p); }
+    static V Zero() { return _mm256_setzero_si256(); }
+    static V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+
+    static V Div255(V x) {
+        x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+        return _mm256_mulhi_epu16(x, _mm256_set1_epi16(257));
+    }
+
+    static V AlphaOf(V px16) {
+        px16 = _mm256_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_shufflehi_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    //Unpack and pack both work within 128 bit lanes, so pixel order is preserved
+    static V Scale(V pixel, V from, bool invert) {
+        const V zero = _mm256_setzero_si256();
+        V lo = _mm256_unpacklo_epi8(pixel, zero);
+        V hi = _mm256_unpackhi_epi8(pixel, zero);
+        V alo = AlphaOf(_mm256_unpacklo_epi8(from, zero));
+        V ahi = AlphaOf(_mm256_unpackhi_epi8(from, zero));
+        if (invert) {
+            alo = _mm256_sub_epi16(_mm256_set1_epi16(255), alo);
+            ahi = _mm256_sub_epi16(_mm256_set1_epi16(255), ahi);
+        }
+        lo = Div255(_mm256_mullo_epi16(lo, alo));
+        hi = Div255(_mm256_mullo_epi16(hi, ahi));
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    static V Lerp(V a, V b, V w) {
+        const V zero = _mm256_setzero_si256();
+        const V half = _mm256_set1_epi16(128);
+        V alo = _mm256_unpacklo_epi8(a, zero);
+        V ahi = _mm256_unpackhi_epi8(a, zero);
+        V lo = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_unpacklo_epi8(b, zero), alo), _mm256_unpacklo_epi32(w, w));
+        V hi = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_unpackhi_epi8(b, zero), ahi), _mm256_unpackhi_epi32(w, w));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(alo, 8), lo), half), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(ahi, 8), hi), half), 8);
+        return _mm256_packus_epi16(lo, hi);
+    }
+};
+
+#endif
+
+#endif
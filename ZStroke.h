@@ -0,0 +1,153 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZStroke_DEFINED
+#define ZStroke_DEFINED
+
+#include "GCanvas.h"
+#include "GPath.h"
+#include "GPoint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//A miter that would reach further than this many radii from its corner is beveled instead
+static const float kMiterLimit = 4;
+
+static GVector rotateVector(GVector v, float cosine, float sine) {
+    return { v.x() * cosine - v.y() * sine, v.x() * sine + v.y() * cosine };
+}
+
+//The signed angle that turns a onto b, positive from +x towards +y
+static float angleBetween(GVector a, GVector b) {
+    return std::atan2(a.x() * b.y() - a.y() * b.x(), a.x() * b.x() + a.y() * b.y());
+}
+
+/**
+ *  Continue the contour with the arc around center that starts at center + from and sweeps
+ *  the given angle. Each cubic covers at most a quarter turn, which keeps it within a tiny
+ *  fraction of the radius of the true circle.
+ */
+static void arcToStroke(GPath& stroke, GPoint center, GVector from, float sweep) {
+    int pieces = (int)std::ceil(std::abs(sweep) / (float)(M_PI / 2) - 1e-4f);
+    if (pieces < 1) return;
+    float step = sweep / pieces;
+    float k = 4.0f / 3 * std::tan(step / 4);
+    float cosine = std::cos(step);
+    float sine = std::sin(step);
+    GVector v = from;
+    for (int i = 0; i < pieces; i++) {
+        GVector next = rotateVector(v, cosine, sine);
+        //Tangents are the radii turned a quarter in the direction of the sweep (k has its sign)
+        GVector t0 = { -v.y() * k, v.x() * k };
+        GVector t1 = { -next.y() * k, next.x() * k };
+        stroke.cubicTo(center + v + t0, center + next - t1, center + next);
+        v = next;
+    }
+}
+
+/**
+ *  Continue the contour around the outside of the corner p, from p + from to p + to, where
+ *  from and to are the offsets (of length radius) of the segments before and after it. turn
+ *  is the angle that the polyline turns by.
+ */
+static void joinToStroke(GPath& stroke, GPoint p, GVector from, GVector to, float turn, float radius, GCanvas::BendType bendType) {
+    switch (bendType) {
+        case GCanvas::Rounded:
+            arcToStroke(stroke, p, from, turn);
+            break;
+        case GCanvas::Miter: {
+            //The miter is at radius / cos(turn / 2) along the bisector of the offsets
+            GVector bisector = from + to;
+            float cosHalf = std::cos(turn / 2);
+            float length = bisector.length();
+            if (cosHalf * kMiterLimit >= 1 && length > 0) {
+                stroke.lineTo(p + bisector * (radius / (cosHalf * length)));
+            }
+            break;
+        }
+        case GCanvas::Bend:
+            break;
+    }
+    stroke.lineTo(p + to);
+}
+
+//Continue the contour around the end p of the polyline, going in direction d, from p + n to p - n
+static void capToStroke(GPath& stroke, GPoint p, GVector d, GVector n, GCanvas::CapType capType) {
+    switch (capType) {
+        case GCanvas::Circle:
+            arcToStroke(stroke, p, n, -(float)M_PI);
+            break;
+        case GCanvas::Square: {
+            GVector out = { d.x() * n.length(), d.y() * n.length() };
+            stroke.lineTo(p + n + out);
+            stroke.lineTo(p - n + out);
+            stroke.lineTo(p - n);
+            break;
+        }
+    }
+}
+
+/**
+ *  Outline the stroke of a polyline as a single contour, so that filling it (non-zero)
+ *  touches each pixel once. The contour runs down the left side of the polyline (the side of
+ *  d turned by +90 degrees), around the end cap, back up the right side and around the start
+ *  cap. At each corner only the outer side gets the join; the inner side passes through the
+ *  corner itself, which stays inside the stroke. Points that repeat the one before them are
+ *  skipped, and a polyline of a single point is drawn as just its two caps.
+ */
+static void strokePolyline(const GPoint pts[], int count, float radius, GCanvas::CapType capType, GCanvas::BendType bendType,
+                           std::vector<GPoint>& points, std::vector<GVector>& directions, GPath& stroke) {
+    points.clear();
+    for (int i = 0; i < count; i++) {
+        if (points.empty() || pts[i] != points.back()) points.push_back(pts[i]);
+    }
+    if (points.empty() || !(radius > 0)) return;
+    int n = (int)points.size();
+    directions.resize(std::max(n - 1, 1));
+    for (int i = 0; i + 1 < n; i++) {
+        GVector d = points[i + 1] - points[i];
+        directions[i] = d * (1 / d.length());
+    }
+    if (n == 1) directions[0] = { 1, 0 };
+    auto normal = [radius](GVector d) { return GVector{ -d.y() * radius, d.x() * radius }; };
+    int segments = std::max(n - 1, 1);
+
+    //Down the left side
+    stroke.moveTo(points[0] + normal(directions[0]));
+    for (int i = 1; i < n; i++) {
+        GVector before = normal(directions[i - 1]);
+        stroke.lineTo(points[i] + before);
+        if (i == n - 1) break;
+        GVector after = normal(directions[i]);
+        float turn = angleBetween(directions[i - 1], directions[i]);
+        if (turn < 0) {
+            joinToStroke(stroke, points[i], before, after, turn, radius, bendType);
+        } else if (turn > 0) {
+            stroke.lineTo(points[i]);
+            stroke.lineTo(points[i] + after);
+        }
+    }
+    capToStroke(stroke, points[n - 1], directions[segments - 1], normal(directions[segments - 1]), capType);
+
+    //Back up the right side, where the offsets are -normal and the turns are reversed
+    for (int i = n - 2; i >= 0; i--) {
+        GVector before = normal(directions[i]) * -1;
+        stroke.lineTo(points[i] + before);
+        if (i == 0) break;
+        GVector after = normal(directions[i - 1]) * -1;
+        float turn = angleBetween(directions[i], directions[i - 1]);
+        if (turn < 0) {
+            joinToStroke(stroke, points[i], before, after, turn, radius, bendType);
+        } else if (turn > 0) {
+            stroke.lineTo(points[i]);
+            stroke.lineTo(points[i] + after);
+        }
+    }
+    GVector back = directions[0] * -1;
+    capToStroke(stroke, points[0], back, normal(back), capType);
+}
+
+#endif
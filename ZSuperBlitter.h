@@ -0,0 +1,216 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZSuperBlitter_DEFINED
+#define ZSuperBlitter_DEFINED
+
+#include "ZBlitter.h"
+
+#include <vector>
+
+//Anti-aliased fills scan 16 samples across and 4 rows down per pixel
+static const int kSuperShiftX = 4;
+static const int kSuperShiftY = 2;
+static const int kSuperScaleX = 1 << kSuperShiftX;
+static const int kSuperScaleY = 1 << kSuperShiftY;
+
+/**
+ *  Coverage for one row of pixels stored as runs. fRuns[i] is the length of the run starting
+ *  at pixel i (only meaningful where a run starts) and fAlpha[i] is its coverage. Adding a
+ *  span only splits runs at its ends, so a wide span costs the same as a narrow one.
+ */
+class ZAlphaRuns {
+
+public:
+
+    void reset(int width) {
+        fRuns.resize(width + 1);
+        fAlpha.resize(width + 1);
+        fRuns[0] = width;
+        fRuns[width] = 0;
+        fAlpha[0] = 0;
+        fWidth = width;
+    }
+
+    bool empty() const { return fRuns[0] == fWidth && fAlpha[0] == 0; }
+
+    const int16_t* runs() const { return fRuns.data(); }
+    const uint8_t* alpha() const { return fAlpha.data(); }
+
+    /**
+     *  Add startAlpha to pixel x, maxValue to the middleCount pixels after it, and stopAlpha to
+     *  the pixel after those. offset is a run start at or before x (0 is always safe); the
+     *  returned offset can be passed to the next add on the same row if it starts further right.
+     */
+    int add(int x, unsigned startAlpha, int middleCount, unsigned stopAlpha, unsigned maxValue, int offset) {
+        int16_t* runs = fRuns.data() + offset;
+        uint8_t* alpha = fAlpha.data() + offset;
+        uint8_t* last = alpha;
+        x -= offset;
+
+        if (startAlpha) {
+            breakRuns(runs, alpha, x, 1);
+            alpha[x] = catchOverflow(alpha[x] + startAlpha);
+            last = alpha + x;
+            runs += x + 1;
+            alpha += x + 1;
+            x = 0;
+        }
+        if (middleCount) {
+            breakRuns(runs, alpha, x, middleCount);
+            runs += x;
+            alpha += x;
+            x = 0;
+            do {
+                alpha[0] = catchOverflow(alpha[0] + maxValue);
+                int n = runs[0];
+                last = alpha;
+                runs += n;
+                alpha += n;
+                middleCount -= n;
+            } while (middleCount > 0);
+        }
+        if (stopAlpha) {
+            breakRuns(runs, alpha, x, 1);
+            alpha += x;
+            alpha[0] = catchOverflow(alpha[0] + stopAlpha);
+            last = alpha;
+        }
+        return (int)(last - fAlpha.data());
+    }
+
+private:
+
+    //Two partial samples of one pixel can sum to 256; keep it at 255
+    static uint8_t catchOverflow(unsigned alpha) {
+        return (uint8_t)(alpha - (alpha >> 8));
+    }
+
+    //Make runs start at x and at x + count
+    static void breakRuns(int16_t runs[], uint8_t alpha[], int x, int count) {
+        int16_t* nextRuns = runs + x;
+        uint8_t* nextAlpha = alpha + x;
+        while (x > 0) {
+            int n = runs[0];
+            if (x < n) {
+                alpha[x] = alpha[0];
+                runs[0] = x;
+                runs[x] = n - x;
+                break;
+            }
+            runs += n;
+            alpha += n;
+            x -= n;
+        }
+
+        runs = nextRuns;
+        alpha = nextAlpha;
+        x = count;
+        for (;;) {
+            int n = runs[0];
+            if (x < n) {
+                alpha[x] = alpha[0];
+                runs[0] = x;
+                runs[x] = n - x;
+                break;
+            }
+            x -= n;
+            if (x <= 0) break;
+            runs += n;
+            alpha += n;
+        }
+    }
+
+    std::vector<int16_t> fRuns;
+    std::vector<uint8_t> fAlpha;
+    int fWidth;
+
+};
+
+/**
+ *  Receives spans from a scan of supersampled edges (x in 1/kSuperScaleX pixels, one row per
+ *  sub-scanline) and accumulates their coverage. Each finished pixel row is handed to the
+ *  real blitter as runs of coverage, so interior spans still reach it as full blitH calls.
+ */
+class ZSuperBlitter : public ZBlitter {
+
+public:
+
+    //runs is only borrowed, so a canvas can keep one between draws
+    ZSuperBlitter(ZBlitter* blitter, int width, ZAlphaRuns* runs) : fBlitter(blitter), fRuns(*runs), fWidth(width), fCurrIY(-1), fCurrY(-1), fOffsetX(0) {
+        fRuns.reset(width);
+    }
+
+    ~ZSuperBlitter() {
+        flush();
+    }
+
+    void blitH(int x, int y, int width) override {
+        int iy = y >> kSuperShiftY;
+        if (iy != fCurrIY) {
+            flush();
+            fCurrIY = iy;
+        }
+        if (y != fCurrY) {
+            fCurrY = y;
+            fOffsetX = 0;
+        }
+
+        int start = std::max(x, 0);
+        int stop = std::min(x + width, fWidth << kSuperShiftX);
+        if (start >= stop) return;
+        int fb = start & (kSuperScaleX - 1);
+        int fe = stop & (kSuperScaleX - 1);
+        int n = (stop >> kSuperShiftX) - (start >> kSuperShiftX) - 1;
+        if (n < 0) {
+            //Starts and stops inside one pixel
+            fb = fe - fb;
+            n = 0;
+            fe = 0;
+        }
+        else if (fb == 0) {
+            n += 1;
+        }
+        else {
+            fb = kSuperScaleX - fb;
+        }
+        fOffsetX = fRuns.add(start >> kSuperShiftX, partialAlpha(fb), n, partialAlpha(fe), maxValue(y), fOffsetX);
+    }
+
+    void flush() {
+        if (fCurrIY >= 0 && !fRuns.empty()) {
+            fBlitter->blitAntiH(0, fCurrIY, fRuns.alpha(), fRuns.runs());
+            fRuns.reset(fWidth);
+        }
+        fCurrIY = -1;
+        fCurrY = -1;
+    }
+
+protected:
+
+    //Spans always arrive through blitH
+    void blitCoverageH(int x, int y, int width, unsigned coverage) override {}
+
+private:
+
+    //Samples covered on one sub-scanline, scaled so a full pixel over all rows is 256
+    static unsigned partialAlpha(int samples) {
+        return samples << (8 - kSuperShiftX - kSuperShiftY);
+    }
+
+    //The last sub-scanline of a pixel gives one less so a full pixel adds up to 255
+    static unsigned maxValue(int y) {
+        return (1 << (8 - kSuperShiftY)) - (((y & (kSuperScaleY - 1)) + 1) >> kSuperShiftY);
+    }
+
+    ZBlitter* fBlitter;
+    ZAlphaRuns& fRuns;
+    int fWidth;
+    int fCurrIY;
+    int fCurrY;
+    int fOffsetX;
+
+};
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZThreadPool_DEFINED
+#define ZThreadPool_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  A fixed set of worker threads that run indexed tasks. run() hands out the indices
+ *  [0, count) one at a time from a shared counter, so uneven tasks balance themselves, and
+ *  the calling thread works on them too until all are done.
+ */
+class ZThreadPool {
+
+public:
+
+    //threads counts the caller, so a pool of 1 runs everything on the calling thread
+    ZThreadPool(int threads) : fTask(nullptr), fGeneration(0), fCount(0), fBusy(0), fQuit(false), fNext(0) {
+        for (int i = 1; i < threads; i++) {
+            fWorkers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~ZThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fQuit = true;
+        }
+        fWake.notify_all();
+        for (std::thread& t : fWorkers) {
+            t.join();
+        }
+    }
+
+    int threads() const { return (int)fWorkers.size() + 1; }
+
+    void run(int count, const std::function<void(int)>& task) {
+        if (count <= 0) return;
+        if (fWorkers.empty() || count == 1) {
+            for (int i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fTask = &task;
+            fCount = count;
+            fNext = 0;
+            fBusy = (int)fWorkers.size();
+            fGeneration++;
+        }
+        fWake.notify_all();
+        drain(task, count);
+
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this]() { return fBusy == 0; });
+        fTask = nullptr;
+    }
+
+private:
+
+    void drain(const std::function<void(int)>& task, int count) {
+        for (int i; (i = fNext.fetch_add(1)) < count; ) {
+            task(i);
+        }
+    }
+
+    void work() {
+        unsigned seen = 0;
+        for (;;) {
+            const std::function<void(int)>* task;
+            int count;
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fWake.wait(lock, [&]() { return fQuit || fGeneration != seen; });
+                if (fQuit) return;
+                seen = fGeneration;
+                task = fTask;
+                count = fCount;
+            }
+            drain(*task, count);
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fBusy--;
+            }
+            fDone.notify_one();
+        }
+    }
+
+    std::vector<std::thread> fWorkers;
+    std::mutex fMutex;
+    std::condition_variable fWake;
+    std::condition_variable fDone;
+    const std::function<void(int)>* fTask;
+    unsigned fGeneration;
+    int fCount;
+    int fBusy;
+    bool fQuit;
+    std::atomic<int> fNext;
+
+};
+
+#endif
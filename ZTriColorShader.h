@@ -1,5 +0,0 @@
-#include "GColor.h"
-#include "GPoint.h"
-#include "GShader.h"
-
-std::unique_ptr<GShader> GCreateTriColorShader(const GPoint pts[], const GColor colors[]);
\ No newline at end of file
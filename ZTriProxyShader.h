@@ -1,5 +0,0 @@
-#include "GColor.h"
-#include "GPoint.h"
-#include "GShader.h"
-
-std::unique_ptr<GShader> GCreateTriProxyShader(const GPoint pts[], const GPoint texs[], GShader* shader);
\ No newline at end of file
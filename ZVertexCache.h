@@ -0,0 +1,96 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef ZVertexCache_DEFINED
+#define ZVertexCache_DEFINED
+
+#include "GMatrix.h"
+#include "GPoint.h"
+#include "GRect.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  A mesh vertex after the CTM: its device point and which sides of the device and of the
+ *  clip it is outside of. A triangle whose three outcodes share a side cannot touch anything.
+ */
+struct ZMeshVertex {
+    enum Outcode : unsigned {
+        kClipLeft = 1 << 0,
+        kClipTop = 1 << 1,
+        kClipRight = 1 << 2,
+        kClipBottom = 1 << 3,
+        kClipAll = 0xF,
+        kDeviceAll = kClipAll << 4,
+    };
+
+    GPoint point;
+    unsigned outcode;
+};
+
+/**
+ *  drawMesh's post-transform cache. Indices into a mesh repeat (a grid uses most vertices in
+ *  six triangles), so each vertex is mapped and classified the first time a triangle uses it
+ *  and read back after that. Entries are marked with the mesh they belong to, so starting a
+ *  new mesh does not clear anything, and the storage is kept from mesh to mesh.
+ */
+class ZVertexCache {
+
+public:
+
+    ZVertexCache() : fStamp(0), fTransformed(0) {}
+
+    //Start a mesh whose indices are all below vertexCount
+    void reset(int vertexCount, const GMatrix& ctm, const GIRect& device, const GIRect& clip) {
+        if (fStamps.size() < (size_t)vertexCount) {
+            fStamps.resize(vertexCount, 0);
+            fVertices.resize(vertexCount);
+        }
+        if (++fStamp == 0) {
+            std::fill(fStamps.begin(), fStamps.end(), 0);
+            fStamp = 1;
+        }
+        fCTM = ctm;
+        fDevice = device;
+        fClip = clip;
+        fTransformed = 0;
+    }
+
+    const ZMeshVertex& get(const GPoint verts[], int index) {
+        ZMeshVertex& v = fVertices[index];
+        if (fStamps[index] != fStamp) {
+            fStamps[index] = fStamp;
+            v.point = fCTM * verts[index];
+            v.outcode = outcode(v.point, fClip) | outcode(v.point, fDevice) << 4;
+            fTransformed++;
+        }
+        return v;
+    }
+
+    //How many vertices of the current mesh have been mapped
+    int transformed() const { return fTransformed; }
+
+private:
+
+    //Matches the clip's quick reject: a pixel center on an edge of a rect is outside of it
+    static unsigned outcode(GPoint p, const GIRect& r) {
+        return (p.x() <= r.fLeft ? ZMeshVertex::kClipLeft : 0) |
+               (p.y() <= r.fTop ? ZMeshVertex::kClipTop : 0) |
+               (p.x() >= r.fRight ? ZMeshVertex::kClipRight : 0) |
+               (p.y() >= r.fBottom ? ZMeshVertex::kClipBottom : 0);
+    }
+
+    std::vector<ZMeshVertex> fVertices;
+    std::vector<uint32_t> fStamps;
+    uint32_t fStamp;
+    int fTransformed;
+    GMatrix fCTM;
+    GIRect fDevice;
+    GIRect fClip;
+
+};
+
+#endif
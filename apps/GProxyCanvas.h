@@ -16,6 +16,8 @@ public:
     void save() override { if (fProxy) fProxy->save(); }
     void restore() override { if (fProxy) fProxy->restore(); }
     void concat(const GMatrix& m) override { if (fProxy) fProxy->concat(m); }
+    void clipRect(const GRect& r) override { if (fProxy) fProxy->clipRect(r); }
+    void clipPath(const GPath& path) override { if (fProxy) fProxy->clipPath(path); }
 
     void drawPaint(const GPaint& p) override {
         if (this->allowDraw()) {
@@ -35,11 +37,43 @@ public:
         }
     }
 
-protected:
-    void onSaveLayer(const GRect* bounds, const GPaint& paint) override {
-        if (fProxy) { fProxy->saveLayer(bounds, paint); }
+    void drawPath(const GPath& path, const GPaint& p) override {
+        if (this->allowDraw()) {
+            fProxy->drawPath(path, p);
+        }
+    }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint& p) override {
+        if (this->allowDraw()) {
+            fProxy->drawMesh(verts, colors, texs, count, indices, p);
+        }
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint& p) override {
+        if (this->allowDraw()) {
+            fProxy->drawQuad(verts, colors, texs, level, p);
+        }
     }
 
+    void drawPatch(const GPoint cubics[12], const GColor colors[4], const GPoint texs[4],
+                   int level, const GPaint& p) override {
+        if (this->allowDraw()) {
+            fProxy->drawPatch(cubics, colors, texs, level, p);
+        }
+    }
+
+    void drawStroke(const GPoint pts[], int count, float thickness, CapType cap, BendType bend,
+                    const GPaint& p) override {
+        if (this->allowDraw()) {
+            fProxy->drawStroke(pts, count, thickness, cap, bend, p);
+        }
+    }
+
+    void flush() override { if (fProxy) fProxy->flush(); }
+    GMeshStats meshStats() const override { return fProxy ? fProxy->meshStats() : GMeshStats(); }
+
 private:
     GCanvas* fProxy;
 };
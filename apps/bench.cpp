@@ -6,12 +6,29 @@
 #include "GCanvas.h"
 #include "GBitmap.h"
 #include "GTime.h"
+#include <atomic>
 #include <memory>
+#include <new>
 #include <string>
 #include <vector>
 #include <sys/stat.h>
 #include <unistd.h>
 
+// Every heap allocation in the process, so --allocs can report what a frame allocates
+static std::atomic<long> gAllocations(0);
+
+void* operator new(size_t size) {
+    gAllocations++;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
 static void setup_bitmap(GBitmap* bitmap, int w, int h) {
     size_t rb = w * sizeof(GPixel);
     bitmap->reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
@@ -23,11 +40,16 @@ enum Mode {
     kOnce,
 };
 
-static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode) {
+// threads == 0 draws on the calling thread, otherwise on a threaded canvas.
+// allocs (if not null) gets the heap allocations per frame, after a first frame has let the
+// canvas grow its scratch buffers.
+static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode,
+                          GPathEngine engine, int threads, double* allocs = nullptr) {
     GISize size = bench->size();
     setup_bitmap(bitmap, size.fWidth, size.fHeight);
 
-    auto canvas = GCreateCanvas(*bitmap);
+    auto canvas = threads > 0 ? GCreateThreadedCanvas(*bitmap, threads)
+                              : GCreateCanvas(*bitmap, engine);
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 size.fWidth, size.fHeight, bench->name());
@@ -42,11 +64,20 @@ static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap,
         case kOnce: N = 4; break;
     }
 
+    if (allocs) {
+        bench->draw(canvas.get());
+        canvas->flush();
+    }
+    long allocations = gAllocations;
     GMSec now = GTime::GetMSec();
     for (int i = 0; i < N || forever; ++i) {
         bench->draw(canvas.get());
+        canvas->flush();
     }
     GMSec dur = GTime::GetMSec() - now;
+    if (allocs) {
+        *allocs = (gAllocations - allocations) * 1.0 / N;
+    }
     return dur * 1.0 / N;
 }
 
@@ -88,6 +119,9 @@ int main(int argc, char** argv) {
     std::vector<double> inScores;
     bool chatty_mode = true;
     bool write_images = false;
+    bool count_allocs = false;
+    GPathEngine engine = GPathEngine::kEdgeList;
+    std::vector<int> threadCounts;
 
     int count = -1;
     while (gBenchFactories[++count]);
@@ -112,6 +146,30 @@ int main(int argc, char** argv) {
             chatty_mode = false;
         } else if (is_arg(argv[i], "writeImages")) {
             write_images = true;
+        } else if (is_arg(argv[i], "allocs")) {
+            count_allocs = true;
+        } else if (is_arg(argv[i], "threads") && i+1 < argc) {
+            // a comma separated sweep, e.g. --threads 1,2,4,8
+            for (const char* p = argv[++i]; *p; ) {
+                char* end;
+                int n = (int)strtol(p, &end, 10);
+                if (end == p || n < 1) {
+                    printf("Bad thread count list %s\n", argv[i]);
+                    return -1;
+                }
+                threadCounts.push_back(n);
+                p = *end == ',' ? end + 1 : end;
+            }
+        } else if (is_arg(argv[i], "engine") && i+1 < argc) {
+            ++i;
+            if (!strcmp(argv[i], "edges")) {
+                engine = GPathEngine::kEdgeList;
+            } else if (!strcmp(argv[i], "accumulate")) {
+                engine = GPathEngine::kAccumulation;
+            } else {
+                printf("Unknown engine %s (edges or accumulate)\n", argv[i]);
+                return -1;
+            }
         } else {
             printf("Unknown arg %s\n", argv[i]);
             return -1;
@@ -133,10 +191,35 @@ int main(int argc, char** argv) {
             continue;
         }
 
+        if (threadCounts.size()) {
+            double first = 0;
+            for (int threads : threadCounts) {
+                GBitmap bm;
+                double allocs = 0;
+                double dur = handle_proc(bench.get(), name, &bm, mode, engine, threads,
+                                         count_allocs ? &allocs : nullptr);
+                if (first == 0) {
+                    first = dur;
+                }
+                printf("%s threads=%d %g [%.2fx]", name, threads, dur, first / dur);
+                if (count_allocs) {
+                    printf(" allocs/frame=%g", allocs);
+                }
+                printf("\n");
+                free(bm.pixels());
+            }
+            continue;
+        }
+
         GBitmap testBM;
-        double dur = handle_proc(bench.get(), name, &testBM, mode);
+        double allocs = 0;
+        double dur = handle_proc(bench.get(), name, &testBM, mode, engine, 0,
+                                 count_allocs ? &allocs : nullptr);
         if (chatty_mode) {
             printf("%s %g", name, dur);
+            if (count_allocs) {
+                printf(" allocs/frame=%g", allocs);
+            }
         }
         if (inScores.size()) {
             if (chatty_mode) {
@@ -6,6 +6,7 @@
 #include "GCanvas.h"
 #include "GBitmap.h"
 #include "GColor.h"
+#include "GPicture.h"
 #include "GRandom.h"
 #include "GRect.h"
 #include <string>
@@ -73,6 +74,7 @@ public:
 #include "bench_pa4.inc"
 #include "bench_pa5.inc"
 #include "bench_pa6.inc"
+#include "bench_perf.inc"
 
 const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* { return new RectsBench(false); },
@@ -155,5 +157,92 @@ const GBenchmark::Factory gBenchFactories[] {
         return new MeshBench(verts, colors, verts, 2, indices, "mesh_both");
      },
 
+    // blend rows
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kClear); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrc); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDst); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOver); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOver); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcIn); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstIn); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcOut); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstOut); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kSrcATop); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kDstATop); },
+    []() -> GBenchmark* { return new BlendModeBench(GBlendMode::kXor); },
+
+    // full frame clears
+    []() -> GBenchmark* { return new ClearBench({1920, 1080}, "clear_1080p"); },
+    []() -> GBenchmark* { return new ClearBench({3840, 2160}, "clear_4k"); },
+    []() -> GBenchmark* { return new ClearBench({7680, 4320}, "clear_8k"); },
+
+    // anti-aliasing
+    []() -> GBenchmark* { return new AntiAliasBench(false); },
+    []() -> GBenchmark* { return new AntiAliasBench(true); },
+
+    // path engines
+    []() -> GBenchmark* { return new LionBench(1, false); },
+    []() -> GBenchmark* { return new LionBench(1, true); },
+    []() -> GBenchmark* { return new LionBench(8, false); },
+    []() -> GBenchmark* { return new LionBench(8, true); },
+    []() -> GBenchmark* { return new LionBench(16, false, { 3840, 2160 }); },
+    []() -> GBenchmark* { return new LionBench(16, true, { 3840, 2160 }); },
+
+    // clipping
+    []() -> GBenchmark* { return new ViewportBench(false); },
+    []() -> GBenchmark* { return new ViewportBench(true); },
+
+    // display lists
+    []() -> GBenchmark* { return new PictureBench(false); },
+    []() -> GBenchmark* { return new PictureBench(true); },
+
+    // large paths
+    []() -> GBenchmark* { return new MapPathBench(1); },
+    []() -> GBenchmark* { return new MapPathBench(8); },
+
+    // meshes
+    []() -> GBenchmark* { return new MeshGridBench(false); },
+    []() -> GBenchmark* { return new MeshGridBench(true); },
+    []() -> GBenchmark* { return new MeshGridBench(false, 6); },
+    []() -> GBenchmark* { return new QuadsBench(8); },
+    []() -> GBenchmark* { return new QuadsBench(-1); },
+    []() -> GBenchmark* { return new WarpBench(false); },
+    []() -> GBenchmark* { return new WarpBench(true); },
+    []() -> GBenchmark* { return new MeshBitmapBench(); },
+
+    // strokes
+    []() -> GBenchmark* { return new StrokeBench(GCanvas::Circle, GCanvas::Rounded, false); },
+    []() -> GBenchmark* { return new StrokeBench(GCanvas::Square, GCanvas::Bend, false); },
+    []() -> GBenchmark* { return new StrokeBench(GCanvas::Square, GCanvas::Miter, false); },
+    []() -> GBenchmark* { return new StrokeBench(GCanvas::Circle, GCanvas::Rounded, true); },
+    []() -> GBenchmark* { return new ChartBench(false); },
+    []() -> GBenchmark* { return new ChartBench(true); },
+
+    // bitmap sampling
+    []() -> GBenchmark* { return new SpriteBench(true, 1); },
+    []() -> GBenchmark* { return new SpriteBench(false, 1); },
+    []() -> GBenchmark* { return new SpriteBench(true, 2); },
+    []() -> GBenchmark* { return new FilterBench(GFilterQuality::kNearest, GShader::kClamp); },
+    []() -> GBenchmark* { return new FilterBench(GFilterQuality::kBilinear, GShader::kClamp); },
+    []() -> GBenchmark* { return new FilterBench(GFilterQuality::kNearest, GShader::kRepeat); },
+    []() -> GBenchmark* { return new FilterBench(GFilterQuality::kBilinear, GShader::kRepeat); },
+    []() -> GBenchmark* { return new ThumbnailBench(GFilterQuality::kNearest); },
+    []() -> GBenchmark* { return new ThumbnailBench(GFilterQuality::kBilinear); },
+    []() -> GBenchmark* { return new ThumbnailBench(GFilterQuality::kMipmap); },
+    []() -> GBenchmark* { return new RotateBench(0, false); },
+    []() -> GBenchmark* { return new RotateBench(15, false); },
+    []() -> GBenchmark* { return new RotateBench(30, false); },
+    []() -> GBenchmark* { return new RotateBench(45, false); },
+    []() -> GBenchmark* { return new RotateBench(60, false); },
+    []() -> GBenchmark* { return new RotateBench(75, false); },
+    []() -> GBenchmark* { return new RotateBench(90, false); },
+    []() -> GBenchmark* { return new RotateBench(0, true); },
+    []() -> GBenchmark* { return new RotateBench(15, true); },
+    []() -> GBenchmark* { return new RotateBench(30, true); },
+    []() -> GBenchmark* { return new RotateBench(45, true); },
+    []() -> GBenchmark* { return new RotateBench(60, true); },
+    []() -> GBenchmark* { return new RotateBench(75, true); },
+    []() -> GBenchmark* { return new RotateBench(90, true); },
+
     nullptr,
 };
@@ -0,0 +1,985 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#include "GCanvas.h"
+#include "GBitmap.h"
+#include "GShader.h"
+#include "GPath.h"
+#include "GPicture.h"
+#include "GRandom.h"
+#include "tests.h"
+
+static unsigned ref_div255(unsigned x) {
+    return (x * 65793 + (1 << 23)) >> 24;
+}
+
+static GPixel ref_scale(unsigned alpha, GPixel p) {
+    return GPixel_PackARGB(ref_div255(alpha * GPixel_GetA(p)), ref_div255(alpha * GPixel_GetR(p)),
+                           ref_div255(alpha * GPixel_GetG(p)), ref_div255(alpha * GPixel_GetB(p)));
+}
+
+static GPixel ref_blend(GBlendMode mode, GPixel s, GPixel d) {
+    unsigned sa = GPixel_GetA(s);
+    unsigned da = GPixel_GetA(d);
+    switch (mode) {
+        case GBlendMode::kClear:   return 0;
+        case GBlendMode::kSrc:     return s;
+        case GBlendMode::kDst:     return d;
+        case GBlendMode::kSrcOver: return s + ref_scale(255 - sa, d);
+        case GBlendMode::kDstOver: return d + ref_scale(255 - da, s);
+        case GBlendMode::kSrcIn:   return ref_scale(da, s);
+        case GBlendMode::kDstIn:   return ref_scale(sa, d);
+        case GBlendMode::kSrcOut:  return ref_scale(255 - da, s);
+        case GBlendMode::kDstOut:  return ref_scale(255 - sa, d);
+        case GBlendMode::kSrcATop: return ref_scale(da, s) + ref_scale(255 - sa, d);
+        case GBlendMode::kDstATop: return ref_scale(sa, d) + ref_scale(255 - da, s);
+        case GBlendMode::kXor:     return ref_scale(255 - da, s) + ref_scale(255 - sa, d);
+    }
+    return 0;
+}
+
+static GPixel rand_pixel(GRandom& rand) {
+    unsigned a = rand.nextU() & 0xFF;
+    return GPixel_PackARGB(a, rand.nextRange(0, a), rand.nextRange(0, a), rand.nextRange(0, a));
+}
+
+class NoiseShader : public GShader {
+public:
+    bool isOpaque() override { return false; }
+    bool setContext(const GMatrix&) override { return true; }
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        for (int i = 0; i < count; ++i) {
+            GRandom rand((x + i) * 7919 + y);
+            row[i] = rand_pixel(rand);
+        }
+    }
+};
+
+// Every blend row (wide or scalar) must match the per-pixel formulas bit for bit,
+// so use an odd width to exercise the vector body and the scalar tail.
+static void test_blend_rows(GTestStats* stats) {
+    const int W = 37, H = 3;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    std::unique_ptr<GCanvas> canvas = GCreateCanvas(bitmap);
+    std::vector<GPixel> before(W * H);
+    NoiseShader shader;
+
+    for (int m = 0; m < 12; ++m) {
+        GBlendMode mode = static_cast<GBlendMode>(m);
+        for (int pass = 0; pass < 2; ++pass) {
+            GRandom rand(m * 31 + pass);
+            for (int i = 0; i < W * H; ++i) {
+                before[i] = bitmap.pixels()[i] = rand_pixel(rand);
+            }
+
+            GPaint paint({ 0.2f, 0.6f, 0.9f, 0.7f });
+            if (pass == 1) {
+                paint.setShader(&shader);
+            }
+            paint.setBlendMode(mode);
+            canvas->drawRect(GRect::WH(W, H), paint);
+
+            bool same = true;
+            for (int y = 0; y < H; ++y) {
+                GPixel row[W];
+                if (pass == 1) {
+                    shader.shadeRow(0, y, W, row);
+                }
+                for (int x = 0; x < W; ++x) {
+                    GPixel src = pass == 1 ? row[x] : GPixel_PackARGB(179, 36, 107, 161);
+                    same &= *bitmap.getAddr(x, y) == ref_blend(mode, src, before[y * W + x]);
+                }
+            }
+            EXPECT_TRUE(stats, same);
+        }
+    }
+    free(bitmap.pixels());
+}
+
+static float coverage_sum(const GBitmap& bitmap) {
+    float sum = 0;
+    for (int y = 0; y < bitmap.height(); ++y) {
+        for (int x = 0; x < bitmap.width(); ++x) {
+            sum += GPixel_GetA(*bitmap.getAddr(x, y)) / 255.0f;
+        }
+    }
+    return sum;
+}
+
+// Anti-aliased edges get partial coverage in proportion to the area they cover,
+// interiors stay fully covered, and the total matches the shape's area.
+static void test_antialias(GTestStats* stats) {
+    const int W = 32, H = 32;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    std::unique_ptr<GCanvas> canvas = GCreateCanvas(bitmap);
+
+    GPaint paint;
+    paint.setAntiAlias(true);
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->drawRect(GRect::LTRB(2.5f, 4.25f, 10, 8), paint);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(2, 6)) - 128) <= 8);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(6, 4)) - 191) <= 8);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(2, 4)) - 96) <= 8);
+    EXPECT_EQ(stats, GPixel_GetA(*bitmap.getAddr(6, 6)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bitmap.getAddr(10, 6)), 0);
+    EXPECT_EQ(stats, GPixel_GetA(*bitmap.getAddr(6, 8)), 0);
+
+    canvas->clear({ 0, 0, 0, 0 });
+    GPath path;
+    path.moveTo(16, 5.5f).lineTo(26.5f, 16).lineTo(16, 26.5f).lineTo(5.5f, 16);
+    canvas->drawPath(path, paint);
+    EXPECT_TRUE(stats, std::abs(coverage_sum(bitmap) - 2 * 10.5f * 10.5f) < 2);
+
+    // Without the flag the same diamond has only full or empty pixels
+    canvas->clear({ 0, 0, 0, 0 });
+    paint.setAntiAlias(false);
+    canvas->drawPath(path, paint);
+    bool aliased = true;
+    for (int i = 0; i < W * H; ++i) {
+        unsigned a = GPixel_GetA(bitmap.pixels()[i]);
+        aliased &= a == 0 || a == 255;
+    }
+    EXPECT_TRUE(stats, aliased);
+    free(bitmap.pixels());
+}
+
+// The accumulation engine computes exact area coverage, including for paths that
+// leave the device and for overlapping contours (winding 2 is still fully covered).
+static void test_accumulation(GTestStats* stats) {
+    const int W = 32, H = 32;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    std::unique_ptr<GCanvas> canvas = GCreateCanvas(bitmap, GPathEngine::kAccumulation);
+
+    GPaint paint;
+    paint.setAntiAlias(true);
+    canvas->clear({ 0, 0, 0, 0 });
+    GPath path;
+    path.addRect(GRect::LTRB(2.5f, 4.25f, 10, 8));
+    path.addRect(GRect::LTRB(4, 5, 6, 7));
+    canvas->drawPath(path, paint);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(2, 6)) - 128) <= 1);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(6, 4)) - 191) <= 1);
+    EXPECT_TRUE(stats, std::abs((int)GPixel_GetA(*bitmap.getAddr(2, 4)) - 96) <= 1);
+    EXPECT_EQ(stats, GPixel_GetA(*bitmap.getAddr(5, 6)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bitmap.getAddr(10, 6)), 0);
+
+    canvas->clear({ 0, 0, 0, 0 });
+    path.reset();
+    path.moveTo(16, 5.5f).lineTo(26.5f, 16).lineTo(16, 26.5f).lineTo(5.5f, 16);
+    path.addRect(GRect::LTRB(-5, -5, 3.5f, 3.5f));
+    canvas->drawPath(path, paint);
+    EXPECT_TRUE(stats, std::abs(coverage_sum(bitmap) - (2 * 10.5f * 10.5f + 3.5f * 3.5f)) < 0.5f);
+    free(bitmap.pixels());
+}
+
+static void draw_busy_scene(GCanvas* canvas, int W, int H, GShader* gradient) {
+    GRandom rand(7);
+    auto rand_pt = [&]() { return GPoint{ rand.nextF() * W * 1.2f - W * 0.1f, rand.nextF() * H * 1.2f - H * 0.1f }; };
+    auto rand_color = [&]() { return GColor{ rand.nextF(), rand.nextF(), rand.nextF(), rand.nextF() }; };
+
+    canvas->clear({ 1, 1, 1, 1 });
+    for (int i = 0; i < 40; ++i) {
+        GPath path;
+        path.moveTo(rand_pt());
+        path.lineTo(rand_pt());
+        auto p1 = rand_pt();
+        path.quadTo(p1, rand_pt());
+        auto p3 = rand_pt();
+        auto p4 = rand_pt();
+        path.cubicTo(p3, p4, rand_pt());
+        GPaint paint(rand_color());
+        paint.setAntiAlias(i & 1);
+        paint.setBlendMode(static_cast<GBlendMode>(i % 12));
+        canvas->drawPath(path, paint);
+
+        const GPoint tri[] = { rand_pt(), rand_pt(), rand_pt() };
+        canvas->drawConvexPolygon(tri, 3, GPaint(rand_color()));
+
+        // The same shader under different matrices in consecutive draws
+        GPaint shaded(gradient);
+        shaded.setAntiAlias(i & 2);
+        canvas->save();
+        canvas->translate(rand.nextF() * W, rand.nextF() * H);
+        canvas->rotate(rand.nextF() * 6);
+        canvas->drawRect(GRect::XYWH(-20, -10, 60, 30), shaded);
+        canvas->restore();
+        canvas->fillRect(GRect::XYWH(rand.nextF() * W, rand.nextF() * H, 30, 20), rand_color());
+    }
+    const GPoint verts[] = { { 10, 10 }, { 150, 30 }, { 60, 180 } };
+    const GColor vcolors[] = { { 1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 0, 0, 1, 1 } };
+    const int indices[] = { 0, 1, 2 };
+    canvas->drawMesh(verts, vcolors, nullptr, 1, indices, GPaint());
+    canvas->drawPath(GPath().addCircle({ 200, 100 }, 50), GPaint({ 0, 0, 0, 0.5f }));
+    canvas->flush();
+}
+
+// A threaded canvas rasterizes in tiles on several threads, but must produce
+// exactly the pixels of the single threaded canvas.
+static std::unique_ptr<GShader> busy_scene_gradient() {
+    const GColor colors[] = { { 1, 0, 0, 1 }, { 0, 0, 1, 0.5f } };
+    return GCreateLinearGradient({ 0, 0 }, { 50, 30 }, colors, 2, GShader::kMirror);
+}
+
+static void test_threaded_canvas(GTestStats* stats) {
+    const int W = 300, H = 200;
+    GBitmap expected, actual;
+    expected.alloc(W, H);
+    actual.alloc(W, H);
+    auto gradient = busy_scene_gradient();
+    draw_busy_scene(GCreateCanvas(expected).get(), W, H, gradient.get());
+    draw_busy_scene(GCreateThreadedCanvas(actual, 4).get(), W, H, gradient.get());
+
+    bool same = true;
+    for (int i = 0; i < W * H; ++i) {
+        same &= expected.pixels()[i] == actual.pixels()[i];
+    }
+    EXPECT_TRUE(stats, same);
+    free(expected.pixels());
+    free(actual.pixels());
+}
+
+static void draw_picture_extras(GCanvas* canvas) {
+    const GPoint quad[] = { { 20, 20 }, { 120, 40 }, { 110, 150 }, { 30, 120 } };
+    const GColor qcolors[] = { { 1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 0, 0, 1, 1 }, { 1, 1, 0, 0.5f } };
+    canvas->drawQuad(quad, qcolors, nullptr, 3, GPaint());
+    const GPoint patch[] = { { 160, 150 }, { 190, 120 }, { 230, 180 }, { 280, 150 }, { 270, 170 }, { 290, 180 },
+                             { 280, 195 }, { 240, 170 }, { 200, 199 }, { 160, 195 }, { 140, 180 }, { 170, 165 } };
+    canvas->drawPatch(patch, qcolors, nullptr, -1, GPaint());
+    const GPoint line[] = { { 150, 20 }, { 250, 60 }, { 180, 150 } };
+    canvas->drawStroke(line, 3, 8, GCanvas::Square, GCanvas::Rounded, GPaint({ 0, 0.5f, 0, 1 }));
+    // Left open on purpose: playback must not leak it into the canvas
+    canvas->save();
+    canvas->translate(40, 40);
+    canvas->clipPath(GPath().addCircle({ 10, 10 }, 12));
+    canvas->drawRect(GRect::XYWH(0, 0, 20, 20), GPaint({ 1, 0, 1, 1 }));
+}
+
+static void test_picture(GTestStats* stats) {
+    const int W = 300, H = 200;
+    GBitmap expected, actual;
+    expected.alloc(W, H);
+    actual.alloc(W, H);
+
+    // The recorded paints point at the shader, so it outlives the picture
+    auto gradient = busy_scene_gradient();
+    auto direct = GCreateCanvas(expected);
+    draw_busy_scene(direct.get(), W, H, gradient.get());
+    direct->save();
+    draw_picture_extras(direct.get());
+    direct->restore();
+    direct->fillRect(GRect::XYWH(0, 0, 10, 10), { 0, 0, 0, 1 });
+
+    auto recorder = GCreateRecordingCanvas();
+    draw_busy_scene(recorder.get(), W, H, gradient.get());
+    draw_picture_extras(recorder.get());
+    auto picture = recorder->finishRecording();
+    EXPECT_TRUE(stats, picture->count() > 0);
+    EXPECT_EQ(stats, recorder->finishRecording()->count(), 0);
+
+    auto canvas = GCreateCanvas(actual);
+    picture->playback(canvas.get());
+    canvas->fillRect(GRect::XYWH(0, 0, 10, 10), { 0, 0, 0, 1 });
+
+    bool same = true;
+    for (int i = 0; i < W * H; ++i) {
+        same &= expected.pixels()[i] == actual.pixels()[i];
+    }
+    EXPECT_TRUE(stats, same);
+    free(expected.pixels());
+    free(actual.pixels());
+}
+
+// Paths are mapped a segment at a time while their edges are built, which must give the same
+// pixels as drawing a copy that was transformed up front, including for segments that are
+// dropped for being above or below the device.
+static void test_path_stream(GTestStats* stats) {
+    const int W = 120, H = 90;
+    GPath path;
+    path.moveTo(-40, -30).lineTo(70, -20).quadTo(150, 40, 60, 110).cubicTo(20, 200, -60, 60, -10, 20);
+    path.addCircle({ 30, 25 }, 18);
+    path.addRect(GRect::LTRB(-30, -200, 10, -150));
+    path.addRect(GRect::LTRB(-20, 300, 140, 340), GPath::kCCW_Direction);
+    path.moveTo(200, 10).quadTo(260, -80, 320, 10).lineTo(260, 60);
+    GMatrix matrix = GMatrix::Concat(GMatrix::Translate(50, 30), GMatrix::Concat(GMatrix::Rotate(0.3f), GMatrix::Scale(0.8f, 1.3f)));
+    GPath mapped = path;
+    mapped.transform(matrix);
+
+    GBitmap streamed, copied;
+    streamed.alloc(W, H);
+    copied.alloc(W, H);
+    for (GPathEngine engine : { GPathEngine::kEdgeList, GPathEngine::kAccumulation }) {
+        for (bool aa : { false, true }) {
+            GPaint paint({ 1, 0.2f, 0.6f, 0.9f });
+            paint.setAntiAlias(aa);
+            auto canvas = GCreateCanvas(streamed, engine);
+            canvas->clear({ 0, 0, 0, 0 });
+            canvas->concat(matrix);
+            canvas->drawPath(path, paint);
+            canvas = GCreateCanvas(copied, engine);
+            canvas->clear({ 0, 0, 0, 0 });
+            canvas->drawPath(mapped, paint);
+            EXPECT_TRUE(stats, coverage_sum(streamed) > 0);
+            EXPECT_TRUE(stats, memcmp(streamed.pixels(), copied.pixels(), W * H * sizeof(GPixel)) == 0);
+        }
+    }
+    // Bounds of a path with only negative coordinates
+    EXPECT_TRUE(stats, GPath().addRect(GRect::LTRB(-30, -20, -10, -5)).bounds() == GRect::LTRB(-30, -20, -10, -5));
+    free(streamed.pixels());
+    free(copied.pixels());
+}
+
+// Clips the busy scene to a rect (kind 0) or to a rotated rect and a circle (kind 1).
+static void apply_test_clip(GCanvas* canvas, int kind) {
+    if (kind == 0) {
+        canvas->translate(10, 5);
+        canvas->clipRect(GRect::LTRB(20.3f, 30.6f, 200.2f, 140.5f));
+        canvas->translate(-10, -5);
+        return;
+    }
+    canvas->save();
+    canvas->translate(150, 100);
+    canvas->rotate(0.5f);
+    canvas->clipRect(GRect::LTRB(-120, -50, 120, 50));
+    canvas->restore();
+    canvas->clipPath(GPath().addCircle({ 170, 90 }, 80));
+}
+
+static void test_clip(GTestStats* stats) {
+    const int W = 300, H = 200;
+    const GPixel kOutside = GPixel_PackARGB(255, 0, 0, 0);
+    auto gradient = busy_scene_gradient();
+    GBitmap full, mask, actual, threaded;
+    full.alloc(W, H);
+    mask.alloc(W, H);
+    actual.alloc(W, H);
+    threaded.alloc(W, H);
+    draw_busy_scene(GCreateCanvas(full).get(), W, H, gradient.get());
+
+    for (int kind = 0; kind < 2; ++kind) {
+        // The clip covers the pixels a fill of the same geometry covers
+        auto maskCanvas = GCreateCanvas(mask);
+        maskCanvas->clear({ 0, 0, 0, 0 });
+        maskCanvas->save();
+        apply_test_clip(maskCanvas.get(), kind);
+        maskCanvas->drawPaint(GPaint({ 1, 1, 1, 1 }));
+        maskCanvas->restore();
+
+        for (GBitmap* bitmap : { &actual, &threaded }) {
+            auto canvas = bitmap == &actual ? GCreateCanvas(actual) : GCreateThreadedCanvas(threaded, 4);
+            canvas->clear({ 0, 0, 0, 1 });
+            canvas->save();
+            apply_test_clip(canvas.get(), kind);
+            draw_busy_scene(canvas.get(), W, H, gradient.get());
+            canvas->restore();
+            // Restored, so this is not clipped
+            canvas->fillRect(GRect::WH(4, 4), { 1, 0, 0, 1 });
+            canvas->flush();
+        }
+
+        bool same = true;
+        bool clipped = false;
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                GPixel expected = GPixel_GetA(*mask.getAddr(x, y)) ? *full.getAddr(x, y) : kOutside;
+                if (x < 4 && y < 4) expected = GPixel_PackARGB(255, 255, 0, 0);
+                clipped |= expected == kOutside;
+                same &= *actual.getAddr(x, y) == expected && *threaded.getAddr(x, y) == expected;
+            }
+        }
+        EXPECT_TRUE(stats, clipped);
+        EXPECT_TRUE(stats, same);
+    }
+    for (GBitmap* bitmap : { &full, &mask, &actual, &threaded }) {
+        free(bitmap->pixels());
+    }
+}
+
+// drawMesh maps each vertex once and drops triangles that cannot draw anything, counting
+// each one under the first reason it is dropped for, without changing any pixels.
+static void test_mesh_cull(GTestStats* stats) {
+    const int W = 100, H = 100;
+    const GPoint verts[] = {
+        { 10, 10 }, { 60, 10 }, { 10, 60 }, { 60, 60 }, // two triangles sharing an edge
+        { 110, 10 },                                     // in line with the first two
+        { 150, 150 }, { 190, 150 }, { 150, 190 },        // off of the device
+        { 80, 80 }, { 95, 80 }, { 80, 95 },              // outside of the clip
+    };
+    GColor colors[11];
+    for (int i = 0; i < 11; ++i) {
+        colors[i] = { 1, i / 10.0f, 1 - i / 10.0f, 0.5f };
+    }
+    const int indices[] = { 0, 1, 2, 1, 3, 2, 0, 1, 4, 5, 6, 7, 8, 9, 10 };
+
+    GBitmap meshed, separate;
+    meshed.alloc(W, H);
+    separate.alloc(W, H);
+    auto canvas = GCreateCanvas(meshed);
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->clipRect(GRect::WH(70, 70));
+    canvas->drawMesh(verts, colors, nullptr, 5, indices, GPaint());
+    GMeshStats counts = canvas->meshStats();
+    EXPECT_TRUE(stats, counts.triangles == 5);
+    EXPECT_TRUE(stats, counts.vertices == 11);
+    EXPECT_TRUE(stats, counts.offDevice == 1);
+    EXPECT_TRUE(stats, counts.clippedOut == 1);
+    EXPECT_TRUE(stats, counts.degenerate == 1);
+    EXPECT_TRUE(stats, counts.drawn == 2);
+    // Counts add up over draws, and a mesh does not reuse the last one's vertices
+    canvas->translate(0.5f, 0.25f);
+    canvas->drawMesh(verts, colors, nullptr, 2, indices, GPaint());
+    EXPECT_TRUE(stats, canvas->meshStats().vertices == 15);
+    EXPECT_TRUE(stats, canvas->meshStats().drawn == 4);
+
+    auto other = GCreateCanvas(separate);
+    other->clear({ 0, 0, 0, 0 });
+    other->clipRect(GRect::WH(70, 70));
+    for (int i = 0; i < 5; ++i) {
+        other->drawMesh(verts, colors, nullptr, 1, indices + 3 * i, GPaint());
+    }
+    other->translate(0.5f, 0.25f);
+    other->drawMesh(verts, colors, nullptr, 2, indices, GPaint());
+    EXPECT_TRUE(stats, coverage_sum(meshed) > 0);
+    EXPECT_TRUE(stats, memcmp(meshed.pixels(), separate.pixels(), W * H * sizeof(GPixel)) == 0);
+    free(meshed.pixels());
+    free(separate.pixels());
+}
+
+// A negative level lets drawQuad pick its own, from the quad's size and twist on the device,
+// and the whole grid is drawn as one mesh that maps each corner once.
+static void test_quad_adaptive(GTestStats* stats) {
+    GBitmap bitmap;
+    bitmap.alloc(256, 256);
+    auto canvas = GCreateCanvas(bitmap);
+    const GColor colors[] = { { 1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 0, 0, 1, 1 }, { 1, 1, 0, 1 } };
+    auto triangles = [&](const GPoint quad[4], int level) {
+        int64_t before = canvas->meshStats().triangles;
+        canvas->drawQuad(quad, colors, nullptr, level, GPaint());
+        return canvas->meshStats().triangles - before;
+    };
+
+    const GPoint twisted[] = { { 0, 0 }, { 200, 0 }, { 100, 100 }, { 0, 200 } };
+    int64_t vertices = canvas->meshStats().vertices;
+    EXPECT_TRUE(stats, triangles(twisted, 3) == 32);
+    EXPECT_TRUE(stats, canvas->meshStats().vertices - vertices == 25);
+    int64_t large = triangles(twisted, -1);
+    EXPECT_TRUE(stats, large > 32 && large < 2000);
+
+    // Too small to need more than one cell, however twisted
+    const GPoint tiny[] = { { 10, 10 }, { 13, 10 }, { 11, 11 }, { 10, 13 } };
+    EXPECT_TRUE(stats, triangles(tiny, -1) == 2);
+    canvas->save();
+    canvas->scale(0.01f, 0.01f);
+    EXPECT_TRUE(stats, triangles(twisted, -1) == 2);
+    canvas->restore();
+
+    // A parallelogram of one color is drawn exactly by two triangles, but different colors at
+    // its corners can still call for more
+    const GPoint flat[] = { { 0, 0 }, { 250, 20 }, { 250, 250 }, { 0, 230 } };
+    const GColor gray[] = { { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 } };
+    int64_t before = canvas->meshStats().triangles;
+    canvas->drawQuad(flat, gray, nullptr, -1, GPaint());
+    EXPECT_TRUE(stats, canvas->meshStats().triangles - before == 2);
+    EXPECT_TRUE(stats, triangles(flat, -1) > 2);
+
+    // Huge quads are capped rather than split into millions of cells
+    canvas->save();
+    canvas->scale(1000, 1000);
+    int64_t huge = triangles(twisted, -1);
+    EXPECT_TRUE(stats, huge > 2000 && huge <= 2 * 256 * 256);
+    canvas->restore();
+    free(bitmap.pixels());
+}
+
+// A Coons patch is evaluated by forward differencing its sides. With straight sides it is
+// the bilinear quad, and it must follow curved sides.
+static void test_patch(GTestStats* stats) {
+    const int W = 128, H = 128;
+    GBitmap patched, quad;
+    patched.alloc(W, H);
+    quad.alloc(W, H);
+    const GPoint corners[] = { { 10, 8 }, { 118, 20 }, { 100, 120 }, { 4, 110 } };
+    const GColor colors[] = { { 1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 0, 0, 1, 1 }, { 1, 1, 0, 0.5f } };
+    GPoint cubics[12];
+    for (int side = 0; side < 4; ++side) {
+        GPoint a = corners[side], b = corners[(side + 1) % 4];
+        cubics[side * 3] = a;
+        cubics[side * 3 + 1] = a * (2 / 3.0f) + b * (1 / 3.0f);
+        cubics[side * 3 + 2] = a * (1 / 3.0f) + b * (2 / 3.0f);
+    }
+    auto canvas = GCreateCanvas(patched);
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->drawPatch(cubics, colors, nullptr, 5, GPaint());
+    EXPECT_TRUE(stats, canvas->meshStats().triangles == 72);
+    EXPECT_TRUE(stats, canvas->meshStats().vertices == 49);
+    auto other = GCreateCanvas(quad);
+    other->clear({ 0, 0, 0, 0 });
+    other->drawQuad(corners, colors, nullptr, 5, GPaint());
+    int most = 0;
+    for (int i = 0; i < W * H; ++i) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            int a = (patched.pixels()[i] >> shift) & 0xFF, b = (quad.pixels()[i] >> shift) & 0xFF;
+            most = std::max(most, abs(a - b));
+        }
+    }
+    EXPECT_TRUE(stats, coverage_sum(patched) > 0);
+    EXPECT_TRUE(stats, most <= 1);
+
+    // The top bulges up to y = 15 at x = 60
+    const GPoint bulge[] = { { 20, 60 }, { 40, 0 }, { 80, 0 }, { 100, 60 }, { 100, 80 }, { 100, 100 },
+                             { 100, 120 }, { 80, 120 }, { 40, 120 }, { 20, 120 }, { 20, 100 }, { 20, 80 } };
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->drawPatch(bulge, colors, nullptr, -1, GPaint());
+    EXPECT_TRUE(stats, GPixel_GetA(*patched.getAddr(60, 18)) > 0);
+    EXPECT_TRUE(stats, GPixel_GetA(*patched.getAddr(60, 12)) == 0);
+    EXPECT_TRUE(stats, GPixel_GetA(*patched.getAddr(25, 40)) == 0);
+    free(patched.pixels());
+    free(quad.pixels());
+}
+
+// Distance from p to the segment ab, and whether p is alongside it (between its ends)
+static float segment_distance(GPoint p, GPoint a, GPoint b, bool* alongside) {
+    float dx = b.x() - a.x(), dy = b.y() - a.y();
+    float t = ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / (dx * dx + dy * dy);
+    *alongside = t >= 0 && t <= 1;
+    t = std::max(0.0f, std::min(1.0f, t));
+    float ex = a.x() + t * dx - p.x(), ey = a.y() + t * dy - p.y();
+    return sqrtf(ex * ex + ey * ey);
+}
+
+// A stroke is one outline, so a translucent stroke blends every pixel it covers exactly once.
+// It covers what is within half the thickness of the polyline: all of it with round joins
+// and caps, and at least the body of each segment with the other joins.
+static void test_stroke(GTestStats* stats) {
+    const int W = 160, H = 120;
+    const float thickness = 12, r = thickness / 2;
+    const GPoint line[] = { { 20, 20 }, { 140, 30 }, { 60, 50 }, { 60, 50 }, { 70, 100 }, { 130, 60 }, { 135, 105 } };
+    const int count = 7;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    auto canvas = GCreateCanvas(bitmap);
+    const GPixel blended = GPixel_PackARGB(128, 0, 128, 0);
+    for (GCanvas::BendType bend : { GCanvas::Rounded, GCanvas::Bend, GCanvas::Miter }) {
+        canvas->clear({ 0, 0, 0, 0 });
+        canvas->drawStroke(line, count, thickness, GCanvas::Circle, bend, GPaint({ 0, 1, 0, 0.5f }));
+        bool once = true, inside = true, outside = true;
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                GPixel pixel = *bitmap.getAddr(x, y);
+                once &= pixel == 0 || pixel == blended;
+                GPoint center = { x + 0.5f, y + 0.5f };
+                float nearest = 1e9f;
+                bool body = false;
+                for (int i = 0; i + 1 < count; ++i) {
+                    if (line[i] == line[i + 1]) continue;
+                    bool alongside;
+                    float d = segment_distance(center, line[i], line[i + 1], &alongside);
+                    nearest = std::min(nearest, d);
+                    body |= alongside && d < r - 0.75f;
+                }
+                bool round = bend == GCanvas::Rounded;
+                if (body || (round && nearest < r - 0.75f)) inside &= pixel != 0;
+                if (nearest > (bend == GCanvas::Miter ? 4 * r : r) + 0.75f) outside &= pixel == 0;
+            }
+        }
+        EXPECT_TRUE(stats, once);
+        EXPECT_TRUE(stats, inside);
+        EXPECT_TRUE(stats, outside);
+    }
+
+    // Square caps reach half the thickness past the ends
+    canvas->clear({ 0, 0, 0, 0 });
+    const GPoint segment[] = { { 40, 60 }, { 120, 60 } };
+    canvas->drawStroke(segment, 2, thickness, GCanvas::Square, GCanvas::Miter, GPaint({ 0, 1, 0, 0.5f }));
+    EXPECT_TRUE(stats, *bitmap.getAddr(40 - 5, 60) == blended && *bitmap.getAddr(120 + 4, 65) == blended);
+    EXPECT_TRUE(stats, *bitmap.getAddr(40 - 7, 60) == 0 && *bitmap.getAddr(120 + 6, 60) == 0);
+    EXPECT_TRUE(stats, *bitmap.getAddr(80, 60 - 7) == 0 && *bitmap.getAddr(80, 60 + 6) == 0);
+    free(bitmap.pixels());
+}
+
+// Strokes at most a pixel thick on the device are hairlines: one pixel per column (or row)
+// along the line, blended once even where segments meet, and split between two pixels when
+// anti-aliased.
+static void test_hairline(GTestStats* stats) {
+    const int W = 120, H = 80;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    auto canvas = GCreateCanvas(bitmap);
+    const GPixel blended = GPixel_PackARGB(128, 128, 0, 0);
+    const GPaint paint({ 1, 0, 0, 0.5f });
+
+    canvas->clear({ 0, 0, 0, 0 });
+    const GPoint flat[] = { { 10.2f, 20.5f }, { 50.7f, 20.5f } };
+    canvas->drawStroke(flat, 2, 1, GCanvas::Square, GCanvas::Miter, paint);
+    bool exact = true;
+    for (int x = 0; x < W; ++x) {
+        exact &= *bitmap.getAddr(x, 20) == (x >= 10 && x <= 50 ? blended : 0);
+    }
+    EXPECT_TRUE(stats, exact);
+    EXPECT_TRUE(stats, fabsf(coverage_sum(bitmap) - 41 * 128 / 255.0f) < 0.01f);
+
+    // A zigzag of shallow and steep segments, in both directions
+    const GPoint zigzag[] = { { 5, 5 }, { 60, 30 }, { 20, 40.3f }, { 30, 75 }, { 115, 50 }, { 100, 10 } };
+    for (bool aa : { false, true }) {
+        GPaint p = paint;
+        p.setAntiAlias(aa);
+        canvas->clear({ 0, 0, 0, 0 });
+        canvas->drawStroke(zigzag, 6, 0, GCanvas::Circle, GCanvas::Rounded, p);
+        // Aliased pixels are blended once, even at the corners
+        if (!aa) {
+            bool once = true;
+            for (int i = 0; i < W * H; ++i) {
+                once &= bitmap.pixels()[i] == 0 || bitmap.pixels()[i] == blended;
+            }
+            EXPECT_TRUE(stats, once);
+        }
+        // Each column of the first segment gets one pixel's worth of coverage
+        bool column = true;
+        for (int x = 10; x < 55; ++x) {
+            int sum = 0;
+            for (int y = 0; y < 5 + (x - 5) * 25 / 55 + 2; ++y) {
+                sum += GPixel_GetA(*bitmap.getAddr(x, y));
+            }
+            column &= abs(sum - 128) <= 2;
+        }
+        EXPECT_TRUE(stats, column);
+    }
+
+    // Clipped, and with ends far off of the device
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->save();
+    canvas->clipRect(GRect::LTRB(20, 10, 100, 70));
+    const GPoint far[] = { { -1e7f, -1e7f }, { 1e7f, 1e7f } };
+    canvas->drawStroke(far, 2, 0, GCanvas::Square, GCanvas::Miter, GPaint({ 1, 0, 0, 1 }));
+    canvas->restore();
+    bool clipped = true;
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            bool inside = x >= 20 && x < 70 && y == x;
+            clipped &= (GPixel_GetA(*bitmap.getAddr(x, y)) != 0) == inside;
+        }
+    }
+    EXPECT_TRUE(stats, clipped);
+
+    // Ends past 2^24 are clipped, not dropped, in either mode
+    for (bool aa : { false, true }) {
+        GPaint p({ 1, 0, 0, 1 });
+        p.setAntiAlias(aa);
+        canvas->clear({ 0, 0, 0, 0 });
+        const GPoint across[] = { { -1e30f, 40.5f }, { 1e30f, 40.5f } };
+        canvas->drawStroke(across, 2, 0, GCanvas::Square, GCanvas::Miter, p);
+        bool row = true;
+        for (int x = 0; x < W; ++x) {
+            row &= *bitmap.getAddr(x, 40) == GPixel_PackARGB(255, 255, 0, 0) && GPixel_GetA(*bitmap.getAddr(x, 39)) == 0;
+        }
+        EXPECT_TRUE(stats, row);
+        EXPECT_TRUE(stats, fabsf(coverage_sum(bitmap) - W) < 0.01f);
+    }
+
+    // Thickness is measured on the device, so a scaled up 1 is a real stroke
+    canvas->clear({ 0, 0, 0, 0 });
+    canvas->scale(8, 8);
+    const GPoint scaled[] = { { 2, 5 }, { 12, 5 } };
+    canvas->drawStroke(scaled, 2, 1, GCanvas::Square, GCanvas::Miter, GPaint({ 1, 0, 0, 1 }));
+    EXPECT_TRUE(stats, GPixel_GetA(*bitmap.getAddr(50, 37)) == 255 && GPixel_GetA(*bitmap.getAddr(50, 42)) == 255);
+    free(bitmap.pixels());
+}
+
+static int ref_tile(int i, int n, GShader::TileMode mode) {
+    switch (mode) {
+        case GShader::kClamp:  return std::max(0, std::min(n - 1, i));
+        case GShader::kRepeat: return ((i % n) + n) % n;
+        case GShader::kMirror: {
+            int r = ((i % (2 * n)) + 2 * n) % (2 * n);
+            return r < n ? r : 2 * n - 1 - r;
+        }
+    }
+    return 0;
+}
+
+// The bitmap shader steps its texel coordinates along a row (eight at a time with AVX2), or
+// copies rows when only translated, or looks up columns when only scaled. With matrices whose
+// inverse is (nearly) exact in binary, every pixel must be the texel that mapping the pixel's
+// center picks out, for rows long and short, near the bitmap and far away.
+static void test_bitmap_shader(GTestStats* stats) {
+    const int W = 13, H = 7;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = y * W + x;
+        }
+    }
+    // local matrix, and its inverse
+    const GMatrix matrices[][2] = {
+        { GMatrix(), GMatrix() },
+        { GMatrix::Scale(2, 4), GMatrix::Scale(0.5f, 0.25f) },
+        { GMatrix(1, 0, -3.25f, 0, 1, 5.5f), GMatrix(1, 0, 3.25f, 0, 1, -5.5f) },
+        { GMatrix(0, -1, 0, 1, 0, 0), GMatrix(0, 1, 0, -1, 0, 0) },
+        { GMatrix(-0.5f, 0, 0, 0, 0.5f, 0), GMatrix(-2, 0, 0, 0, 2, 0) },
+        { GMatrix(3, 0, 0.75f, 0, 1, 0), GMatrix(1 / 3.0f, 0, -0.25f, 0, 1, 0) },
+        { GMatrix(1, 0, 3e6f, 0, 1, -3e6f), GMatrix(1, 0, -3e6f, 0, 1, 3e6f) },
+    };
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    const int counts[] = { 1, 7, 8, 61 };
+    GPixel row[64];
+    for (auto& m : matrices) {
+        for (auto mode : modes) {
+            std::unique_ptr<GShader> shader = GCreateBitmapShader(bitmap, m[0], mode);
+            EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+            bool same = true;
+            for (int count : counts) {
+                for (int y = -9; y < 20; y += 4) {
+                    int x = -30 + count;
+                    shader->shadeRow(x, y, count, row);
+                    for (int i = 0; i < count; ++i) {
+                        GPoint p = m[1] * GPoint{ x + i + 0.5f, y + 0.5f };
+                        int tx = ref_tile((int)std::floor(p.x()), W, mode);
+                        int ty = ref_tile((int)std::floor(p.y()), H, mode);
+                        same &= row[i] == (GPixel)(ty * W + tx);
+                    }
+                }
+            }
+            EXPECT_TRUE(stats, same);
+            EXPECT_FALSE(stats, shader->isOpaque());
+        }
+    }
+    bitmap.setIsOpaque(GBitmap::kYes_IsOpaque);
+    EXPECT_TRUE(stats, GCreateBitmapShader(bitmap, GMatrix())->isOpaque());
+    free(bitmap.pixels());
+}
+
+// Bilinear filtering at a sample point with exact 8 bit weights, in doubles
+static double ref_bilerp_channel(const GBitmap& bm, GPoint p, GShader::TileMode mode, int shift) {
+    double u = p.x() - 0.5, v = p.y() - 0.5;
+    int x0 = (int)std::floor(u), y0 = (int)std::floor(v);
+    double wx = std::floor((u - x0) * 256) / 256, wy = std::floor((v - y0) * 256) / 256;
+    auto texel = [&](int x, int y) {
+        GPixel c = *bm.getAddr(ref_tile(x, bm.width(), mode), ref_tile(y, bm.height(), mode));
+        return (double)((c >> shift) & 0xFF);
+    };
+    return (texel(x0, y0) * (1 - wx) + texel(x0 + 1, y0) * wx) * (1 - wy) +
+           (texel(x0, y0 + 1) * (1 - wx) + texel(x0 + 1, y0 + 1) * wx) * wy;
+}
+
+// Filtered rows must blend the texels around each sample to within a unit of the exact
+// blend, stay premultiplied, and come out the same whether shaded wide or a pixel at a time.
+// Whole texel translates land on texel centers, so they match nearest sampling exactly.
+static void test_bitmap_filter(GTestStats* stats) {
+    const int W = 9, H = 5;
+    GRandom rand(17);
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = rand_pixel(rand);
+        }
+    }
+    // local matrix, and its inverse
+    const GMatrix matrices[][2] = {
+        { GMatrix::Scale(8, 4), GMatrix::Scale(0.125f, 0.25f) },
+        { GMatrix(2, 1, 0.5f, 0, 4, 0), GMatrix(0.5f, -0.125f, -0.25f, 0, 0.25f, 0) },
+        { GMatrix(0, -2, 0.25f, 2, 0, 0), GMatrix(0, 0.5f, 0, -0.5f, 0, 0.125f) },
+    };
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    const int N = 37;
+    GPixel row[N], pixel;
+    for (auto& m : matrices) {
+        for (auto mode : modes) {
+            std::unique_ptr<GShader> shader = GCreateBitmapShader(bitmap, m[0], mode, GFilterQuality::kBilinear);
+            EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+            bool same = true, close = true, premul = true;
+            // rows that run off of the bitmap, and rows inside of it (for the larger scales)
+            for (int y = -11; y < 30; y += 3) {
+                for (int x : { -10, 7 }) {
+                    int count = x < 0 ? N : 24;
+                    shader->shadeRow(x, y, count, row);
+                    for (int i = 0; i < count; ++i) {
+                        shader->shadeRow(x + i, y, 1, &pixel);
+                        same &= pixel == row[i];
+                        GPoint p = m[1] * GPoint{ x + i + 0.5f, y + 0.5f };
+                        for (int shift = 0; shift < 32; shift += 8) {
+                            close &= std::abs(((row[i] >> shift) & 0xFF) - ref_bilerp_channel(bitmap, p, mode, shift)) <= 1;
+                        }
+                        unsigned a = GPixel_GetA(row[i]);
+                        premul &= GPixel_GetR(row[i]) <= a && GPixel_GetG(row[i]) <= a && GPixel_GetB(row[i]) <= a;
+                    }
+                }
+            }
+            EXPECT_TRUE(stats, same);
+            EXPECT_TRUE(stats, close);
+            EXPECT_TRUE(stats, premul);
+        }
+    }
+    GPixel nearest[N];
+    for (auto mode : modes) {
+        const GMatrix translate = GMatrix::Translate(3, -2);
+        std::unique_ptr<GShader> filtered = GCreateBitmapShader(bitmap, translate, mode, GFilterQuality::kBilinear);
+        std::unique_ptr<GShader> shader = GCreateBitmapShader(bitmap, translate, mode);
+        filtered->setContext(GMatrix());
+        shader->setContext(GMatrix());
+        filtered->shadeRow(-7, 4, N, row);
+        shader->shadeRow(-7, 4, N, nearest);
+        EXPECT_TRUE(stats, std::equal(row, row + N, nearest));
+    }
+    free(bitmap.pixels());
+}
+
+// Minified mipmapped bitmaps are sampled from box-filtered levels. At half size, pixel centers
+// land on the centers of level 1's texels, so each pixel is exactly the rounded average of a
+// 2x2 block. A one texel checkerboard averages to gray at any smaller size, where nearest
+// sampling would alias to black or white. Every level is a copy made with the shader.
+static void test_bitmap_mipmap(GTestStats* stats) {
+    const int W = 64, H = 32;
+    GRandom rand(23);
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = rand_pixel(rand);
+        }
+    }
+    std::unique_ptr<GShader> shader = GCreateBitmapShader(bitmap, GMatrix::Scale(0.5f, 0.5f), GShader::kClamp,
+                                                          GFilterQuality::kMipmap);
+    EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+    GPixel row[W / 2];
+    bool same = true;
+    for (int y = 0; y < H / 2; ++y) {
+        shader->shadeRow(0, y, W / 2, row);
+        for (int x = 0; x < W / 2; ++x) {
+            const GPixel block[] = { *bitmap.getAddr(2 * x, 2 * y), *bitmap.getAddr(2 * x + 1, 2 * y),
+                                     *bitmap.getAddr(2 * x, 2 * y + 1), *bitmap.getAddr(2 * x + 1, 2 * y + 1) };
+            for (int shift = 0; shift < 32; shift += 8) {
+                unsigned sum = 2;
+                for (GPixel p : block) {
+                    sum += (p >> shift) & 0xFF;
+                }
+                same &= ((row[x] >> shift) & 0xFF) == sum >> 2;
+            }
+        }
+    }
+    EXPECT_TRUE(stats, same);
+
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = ((x ^ y) & 1) ? GPixel_PackARGB(255, 255, 255, 255) : GPixel_PackARGB(255, 0, 0, 0);
+        }
+    }
+    bitmap.setIsOpaque(GBitmap::kYes_IsOpaque);
+    for (float scale : { 0.5f, 0.25f, 0.125f, 0.1f }) {
+        shader = GCreateBitmapShader(bitmap, GMatrix::Scale(scale, scale), GShader::kRepeat, GFilterQuality::kMipmap);
+        EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+        EXPECT_TRUE(stats, shader->isOpaque());
+        bool gray = true;
+        for (int y = 0; y < 8; ++y) {
+            shader->shadeRow(0, y, W / 2, row);
+            for (int x = 0; x < W / 2; ++x) {
+                gray &= row[x] == GPixel_PackARGB(255, 128, 128, 128);
+            }
+        }
+        EXPECT_TRUE(stats, gray);
+    }
+    // The shader keeps the pixels it was created with, at full size as well as minified
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = GPixel_PackARGB(255, 255, 0, 0);
+        }
+    }
+    EXPECT_TRUE(stats, shader->setContext(GMatrix::Scale(10, 10)));
+    shader->shadeRow(0, 0, 2, row);
+    EXPECT_TRUE(stats, row[0] == GPixel_PackARGB(255, 0, 0, 0) && row[1] == GPixel_PackARGB(255, 255, 255, 255));
+    EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+    shader->shadeRow(0, 0, 1, row);
+    EXPECT_TRUE(stats, row[0] == GPixel_PackARGB(255, 128, 128, 128));
+    free(bitmap.pixels());
+
+    // Odd sizes repeat their last row and column, and a tiny draw samples the 1x1 level
+    bitmap.alloc(7, 5);
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 7; ++x) {
+            *bitmap.getAddr(x, y) = rand_pixel(rand);
+        }
+    }
+    for (float scale : { 0.3f, 0.001f }) {
+        shader = GCreateBitmapShader(bitmap, GMatrix::Concat(GMatrix::Rotate(0.3f), GMatrix::Scale(scale, scale)),
+                                     GShader::kMirror, GFilterQuality::kMipmap);
+        EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+        bool premul = true;
+        for (int y = -3; y < 6; ++y) {
+            shader->shadeRow(-3, y, 9, row);
+            for (int x = 0; x < 9; ++x) {
+                unsigned a = GPixel_GetA(row[x]);
+                premul &= GPixel_GetR(row[x]) <= a && GPixel_GetG(row[x]) <= a && GPixel_GetB(row[x]) <= a;
+                if (scale < 0.01f) premul &= row[x] == row[0];
+            }
+        }
+        EXPECT_TRUE(stats, premul);
+    }
+    free(bitmap.pixels());
+}
+
+// A blocked bitmap shader samples a copy of the bitmap laid out in 8x8 blocks, which must pick
+// out the same texels as the bitmap itself, including along edges that end partway through a
+// block. The copy is made when the shader is, while other shaders keep reading the bitmap.
+static void test_bitmap_blocks(GTestStats* stats) {
+    const int W = 45, H = 37;
+    GBitmap bitmap;
+    bitmap.alloc(W, H);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            *bitmap.getAddr(x, y) = y * W + x;
+        }
+    }
+    // local matrix, and its inverse
+    const GMatrix matrices[][2] = {
+        { GMatrix(), GMatrix() },
+        { GMatrix::Scale(2, 0.5f), GMatrix::Scale(0.5f, 2) },
+        { GMatrix(0, -1, 0, 1, 0, 0), GMatrix(0, 1, 0, -1, 0, 0) },
+        { GMatrix(0.5f, -0.5f, 20, 0.5f, 0.5f, -5), GMatrix(1, 1, -15, -1, 1, 25) },
+        { GMatrix(1, 0.25f, -7.5f, 0, 1, 3), GMatrix(1, -0.25f, 8.25f, 0, 1, -3) },
+    };
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    const int counts[] = { 1, 8, 61, 200 };
+    GPixel row[200];
+    for (auto& m : matrices) {
+        for (auto mode : modes) {
+            std::unique_ptr<GShader> shader = GCreateBlockedBitmapShader(bitmap, m[0], mode);
+            EXPECT_TRUE(stats, shader->setContext(GMatrix()));
+            bool same = true;
+            for (int count : counts) {
+                for (int y = -20; y < 80; y += 7) {
+                    int x = -50 - count / 2;
+                    shader->shadeRow(x, y, count, row);
+                    for (int i = 0; i < count; ++i) {
+                        GPoint p = m[1] * GPoint{ x + i + 0.5f, y + 0.5f };
+                        int tx = ref_tile((int)std::floor(p.x()), W, mode);
+                        int ty = ref_tile((int)std::floor(p.y()), H, mode);
+                        same &= row[i] == (GPixel)(ty * W + tx);
+                    }
+                }
+            }
+            EXPECT_TRUE(stats, same);
+        }
+    }
+
+    const GMatrix rotate = matrices[2][0];
+    std::unique_ptr<GShader> blocked = GCreateBlockedBitmapShader(bitmap, rotate);
+    std::unique_ptr<GShader> plain = GCreateBitmapShader(bitmap, rotate);
+    EXPECT_TRUE(stats, blocked->setContext(GMatrix()) && plain->setContext(GMatrix()));
+    // Device pixel (-6, 3) maps to texel (3, 5)
+    *bitmap.getAddr(3, 5) = 7;
+    EXPECT_TRUE(stats, blocked->setContext(GMatrix()) && plain->setContext(GMatrix()));
+    blocked->shadeRow(-6, 3, 1, row);
+    EXPECT_EQ(stats, row[0], (GPixel)(5 * W + 3));
+    plain->shadeRow(-6, 3, 1, row);
+    EXPECT_EQ(stats, row[0], (GPixel)7);
+
+    // Whether the copy is opaque is taken along with it
+    EXPECT_FALSE(stats, blocked->isOpaque());
+    bitmap.setIsOpaque(GBitmap::kYes_IsOpaque);
+    EXPECT_TRUE(stats, GCreateBlockedBitmapShader(bitmap, rotate)->isOpaque());
+    free(bitmap.pixels());
+}
@@ -32,6 +32,7 @@ private:
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_engine.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_matrix,      "matrix_setters"    },
@@ -49,6 +50,23 @@ const GTestRec gTestRecs[] = {
     { test_path_chop_quad,   "path_chop_quad"    },
     { test_path_chop_cubic,   "path_chop_cubic"    },
 
+    { test_blend_rows,  "blend_rows"        },
+    { test_antialias,   "antialias"         },
+    { test_accumulation, "accumulation"     },
+    { test_threaded_canvas, "threaded_canvas" },
+    { test_picture,     "picture"           },
+    { test_clip,        "clip"              },
+    { test_path_stream, "path_stream"       },
+    { test_mesh_cull,   "mesh_cull"         },
+    { test_quad_adaptive, "quad_adaptive"   },
+    { test_patch,       "patch"             },
+    { test_stroke,      "stroke"            },
+    { test_hairline,    "hairline"          },
+    { test_bitmap_shader, "bitmap_shader"   },
+    { test_bitmap_filter, "bitmap_filter"   },
+    { test_bitmap_mipmap, "bitmap_mipmap"   },
+    { test_bitmap_blocks, "bitmap_blocks"   },
+
     { nullptr, nullptr },
 };
 
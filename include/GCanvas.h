@@ -7,6 +7,7 @@
 
 #include "GMatrix.h"
 #include "GPaint.h"
+#include <cstdint>
 #include <string>
 
 class GBitmap;
@@ -14,12 +15,25 @@ class GPath;
 class GPoint;
 class GRect;
 
+/**
+ *  What drawMesh (and drawQuad, which draws through it) did with its triangles. Each rejected
+ *  triangle is counted once, by the first test that rejects it, in the order below.
+ */
+struct GMeshStats {
+    int64_t triangles = 0;  // submitted
+    int64_t vertices = 0;   // mapped by the CTM, once per vertex a mesh uses
+    int64_t offDevice = 0;  // entirely off of the device
+    int64_t clippedOut = 0; // on the device, but entirely outside of the clip
+    int64_t degenerate = 0; // without area on the device (or in texture space)
+    int64_t drawn = 0;      // rasterized
+};
+
 class GCanvas {
 public:
     virtual ~GCanvas() {}
 
     /**
-     *  Save off a copy of the canvas state (CTM), to be later used if the balancing call to
+     *  Save off a copy of the canvas state (CTM and clip), to be later used if the balancing call to
      *  restore() is made. Calls to save/restore can be nested:
      *  save();
      *      save();
@@ -32,7 +46,7 @@ public:
     virtual void save() = 0;
 
     /**
-     *  Copy the canvas state (CTM) that was record in the correspnding call to save() back into
+     *  Copy the canvas state (CTM and clip) that was record in the correspnding call to save() back into
      *  the canvas. It is an error to call restore() if there has been no previous call to save().
      */
     virtual void restore() = 0;
@@ -45,6 +59,19 @@ public:
      */
     virtual void concat(const GMatrix& matrix) = 0;
 
+    /**
+     *  Intersect the clip with the rectangle, transformed by the CTM. Draws only change the
+     *  pixels inside the clip, using the same "containment" rule as drawRect. The canvas is
+     *  constructed with the clip set to the bitmap, and save/restore save and restore the
+     *  clip along with the CTM.
+     */
+    virtual void clipRect(const GRect&) = 0;
+
+    /**
+     *  Intersect the clip with the path (non-zero winding), transformed by the CTM.
+     */
+    virtual void clipPath(const GPath&) = 0;
+
     /**
      *  Fill the entire canvas with the specified color, using the specified blendmode.
      */
@@ -118,10 +145,28 @@ public:
      *      3---2
      *
      *  colors and/or texs can be null. The resulting triangles should be passed to drawMesh(...).
+     *
+     *  A negative level lets the canvas pick one from how large and how far from a
+     *  parallelogram the quad (and its colors and texs) are on the device, so small quads
+     *  get few triangles and large, twisted ones get enough to look smooth.
      */
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Draw a Coons patch: the surface bounded by four cubics that share their end points,
+     *  given clockwise from the top-left corner in 12 points:
+     *      top:    cubics[0], cubics[1], cubics[2], cubics[3]
+     *      right:  cubics[3], cubics[4], cubics[5], cubics[6]
+     *      bottom: cubics[6], cubics[7], cubics[8], cubics[9]     (right to left)
+     *      left:   cubics[9], cubics[10], cubics[11], cubics[0]   (bottom to top)
+     *  colors and/or texs, if not null, are at the corners cubics[0], [3], [6] and [9], in the
+     *  same order as drawQuad's, and are interpolated across the patch the same way. level
+     *  tesselates the patch like drawQuad's, including a negative level.
+     */
+    virtual void drawPatch(const GPoint cubics[12], const GColor colors[4], const GPoint texs[4],
+                           int level, const GPaint&) = 0;
+
     enum CapType {
         Circle,
         Square,
@@ -133,6 +178,12 @@ public:
         Miter,
     };
 
+    /**
+     *  Stroke the polyline with the thickness, caps and joins. A thickness of at most one pixel
+     *  on the device (including 0) draws a hairline instead: one pixel wide, without caps or
+     *  joins. An aliased hairline blends each pixel of a translucent line once; an anti-aliased
+     *  one can blend a pixel next to a corner twice.
+     */
     virtual void drawStroke(const GPoint points[], int count, float thickness, CapType capType, BendType bendType, const GPaint& paint) = 0;
 
     // Helpers
@@ -149,6 +200,15 @@ public:
         this->concat(GMatrix::Rotate(radians));
     }
 
+    /**
+     *  Finish any drawing the canvas has deferred. Once this returns the bitmap holds the
+     *  result of every draw so far. Canvases that draw immediately do nothing.
+     */
+    virtual void flush() {}
+
+    //Totals since the canvas was made. Canvases that do not keep them return zeros.
+    virtual GMeshStats meshStats() const { return GMeshStats(); }
+
     void clear(const GColor& color) {
         GPaint paint(color);
         paint.setBlendMode(GBlendMode::kSrc);
@@ -166,6 +226,30 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  How drawPath turns a path into coverage.
+ *
+ *  kEdgeList     sorts the path's edges and walks them one scanline at a time (the default).
+ *  kAccumulation adds each edge's signed area to a per-pixel buffer and resolves coverage with
+ *                a prefix sum along each row. Its cost does not grow with edge crossings, so
+ *                it suits dense artwork with many edges. It is always anti-aliased internally;
+ *                aliased paints keep the pixels that are at least half covered.
+ */
+enum class GPathEngine {
+    kEdgeList,
+    kAccumulation,
+};
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, GPathEngine engine);
+
+/**
+ *  A canvas that records draws and rasterizes them on a pool of threads (including the
+ *  caller) when flush() is called or the canvas is destroyed. The device is split into tiles
+ *  that each replay their draws in order, so the pixels match GCreateCanvas exactly. Shaders
+ *  and bitmaps used by a draw must stay alive until the next flush.
+ */
+std::unique_ptr<GCanvas> GCreateThreadedCanvas(const GBitmap& bitmap, int threads);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
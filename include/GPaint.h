@@ -34,10 +34,14 @@ public:
     GShader* getShader() const { return fShader; }
     GPaint&  setShader(GShader* s) { fShader = s; return *this; }
 
+    bool    isAntiAlias() const { return fAntiAlias; }
+    GPaint& setAntiAlias(bool aa) { fAntiAlias = aa; return *this; }
+
 private:
     GColor      fColor = {0, 0, 0, 1};
     GShader*    fShader = nullptr;
     GBlendMode  fMode = GBlendMode::kSrcOver;
+    bool        fAntiAlias = false;
 };
 
 #endif
@@ -0,0 +1,48 @@
+/**
+ *  Copyright 2022 Zack Schrage
+ */
+
+#ifndef GPicture_DEFINED
+#define GPicture_DEFINED
+
+#include "GCanvas.h"
+#include <memory>
+
+/**
+ *  An immutable list of canvas calls that can be drawn again into any canvas. Playing it back
+ *  reuses scratch space that the picture owns, so a picture is played back on one thread at a
+ *  time.
+ */
+class GPicture {
+public:
+    virtual ~GPicture() {}
+
+    /**
+     *  Replay the calls into the canvas, on top of its current CTM and clip. The canvas'
+     *  save/restore state is the same after playback as before it, even if the recording left
+     *  saves open.
+     */
+    virtual void playback(GCanvas* canvas) const = 0;
+
+    //The number of calls that were recorded, including save/restore/concat and clips
+    virtual int count() const = 0;
+};
+
+/**
+ *  A canvas that draws nothing and instead records every call made to it.
+ *
+ *  The paints are recorded as they are, so the shaders they point to must stay alive for as
+ *  long as the picture is played back. Everything else (points, paths, matrices) is copied.
+ */
+class GRecordingCanvas : public GCanvas {
+public:
+    /**
+     *  Return the calls recorded so far as a picture, and start over with an empty recording
+     *  and an identity CTM.
+     */
+    virtual std::unique_ptr<GPicture> finishRecording() = 0;
+};
+
+std::unique_ptr<GRecordingCanvas> GCreateRecordingCanvas();
+
+#endif
@@ -47,6 +47,37 @@ public:
 std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap&, const GMatrix& localMatrix,
                                              GShader::TileMode = GShader::kClamp);
 
+/**
+ *  How a bitmap shader colors a pixel whose center falls between texel centers.
+ *
+ *  kNearest   takes the texel that the center falls in (the default).
+ *  kBilinear  blends the four texels whose centers surround it, weighted by how close it is to
+ *             each (to 1/256 of a texel), which smooths bitmaps that are scaled up or rotated.
+ *  kMipmap    is kBilinear, except that a bitmap drawn at half its size or less is sampled from
+ *             a copy downsampled by a power of 2 (a mip level) with one to two texels per pixel,
+ *             so it does not alias and reads less memory. The shader copies the bitmap and
+ *             builds every level when it is created, so later changes to the bitmap's pixels
+ *             do not show in it.
+ */
+enum class GFilterQuality {
+    kNearest,
+    kBilinear,
+    kMipmap,
+};
+
+std::unique_ptr<GShader> GCreateBitmapShader(const GBitmap&, const GMatrix& localMatrix,
+                                             GShader::TileMode, GFilterQuality);
+
+/**
+ *  Return a bitmap shader (kNearest) that copies the bitmap's texels when it is created, into
+ *  8x8 blocks that are each contiguous in memory, and samples that copy. Texels that are near
+ *  each other in either direction are then near each other in memory, so drawing a large
+ *  bitmap rotated reads about as little memory as drawing it upright. Later changes to the
+ *  bitmap's pixels do not show in the shader.
+ */
+std::unique_ptr<GShader> GCreateBlockedBitmapShader(const GBitmap&, const GMatrix& localMatrix,
+                                                    GShader::TileMode = GShader::kClamp);
+
 /**
  *  Return a subclass of GShader that draws the specified gradient of [count] colors between
  *  the two points. Color[0] corresponds to p0, and Color[count-1] corresponds to p1, and all